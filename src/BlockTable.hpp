@@ -0,0 +1,139 @@
+#ifndef BLOCKTABLE_HPP
+#define BLOCKTABLE_HPP
+
+#include "includes.hpp"
+#include "SufficientStatistics.hpp"
+#include "MultiVector.hpp"
+#include "EFD.hpp"
+
+
+const size_t INNER_PRODUCT_BATCH_SIZE = 16;	// number of blocks whose inner products samplers compute at once, see BlockTable::innerProducts()
+
+
+// A materialized block structure, i.e. the start and size of each block as well as its sufficient statistics for each data dimension. Each field, and the statistics of each dimension, are stored in their own contiguous array (for Normal statistics, one per component, see MultiVector), so that samplers can make several passes over the blocks of an iteration without recomputing them from the block structure and statistics, and compute the inner products of several blocks at once.
+template<typename T>
+class BlockTable {
+
+		size_t mNrDim;
+		vector<size_t> mStarts;
+		vector<size_t> mSizes;
+		MultiVector<SufficientStatistics<T>> mStats;	// mStats( b, d ) holds the statistics of dimension d in block b
+
+	public:
+
+		// Access to a single block, which can be used like Emissions in innerProduct() etc.
+		class Block {
+				const BlockTable& mTable;
+				const size_t mIndex;
+
+			public:
+
+				Block(
+				    const BlockTable& table,
+				    const size_t index ) :
+					mTable( table ),
+					mIndex( index ) {}
+
+				size_t nrDim() const {
+					return mTable.nrDim();
+				}
+
+				size_t blockSize() const {
+					return mTable.blockSize( mIndex );
+				}
+
+				SufficientStatistics<T> suffStat( size_t dim ) const {
+					return mTable.suffStat( mIndex, dim );
+				}
+		};
+
+
+		BlockTable( const size_t nrDim ) :
+			mNrDim( nrDim ),
+			mStats( nrDim ) {
+		}
+
+		// remove all blocks, but keep the allocated memory for the next block structure
+		void clear() {
+			mStarts.clear();
+			mSizes.clear();
+			mStats.clear();
+		}
+
+		// append the current block of <blocks> with the current statistics of <stats>
+		template<typename BlocksType, typename StatsType>
+		void push_back(
+		    const BlocksType& blocks,
+		    const StatsType& stats ) {
+			const size_t b = mSizes.size();
+			mStarts.push_back( blocks.start() );
+			mSizes.push_back( blocks.blockSize() );
+			mStats.resize( b + 1 );
+			for ( size_t d = 0; d < mNrDim; ++d ) {
+				mStats.set( b, d, stats.suffStat( d ) );
+			}
+		}
+
+		size_t nrBlocks() const {
+			return mSizes.size();
+		}
+
+		size_t nrDim() const {
+			return mNrDim;
+		}
+
+		size_t start( const size_t b ) const {
+			return mStarts[b];
+		}
+
+		size_t end( const size_t b ) const {
+			return mStarts[b] + mSizes[b];
+		}
+
+		size_t blockSize( const size_t b ) const {
+			return mSizes[b];
+		}
+
+		SufficientStatistics<T> suffStat(
+		    const size_t b,
+		    const size_t dim ) const {
+			return mStats.get( b, dim );
+		}
+
+		// Write the inner products of the statistics of <count> blocks starting at <first> with <param> under <mapping> to <result>, which equal innerProduct( block( b ), param, mapping ).
+		template<typename ParamType>
+		void innerProducts(
+		    const size_t first,
+		    const size_t count,
+		    const vector<Observation<ParamType>>& param,
+		    const vector<size_t>& mapping,
+		    real_t* result ) const {
+			for ( size_t i = 0; i < count; ++i ) {
+				result[i] = 0;
+			}
+			for ( size_t d = 0; d < mNrDim; ++d ) {
+				addInnerProducts( mStats, d, first, count, param[mapping[d]], result );
+			}
+		}
+
+		Block block( const size_t b ) const {
+			return Block( *this, b );
+		}
+
+		// a hash of the block boundaries, which together with nrBlocks() detects whether a block structure has changed
+		uint64_t boundaryHash() const {
+			uint64_t hash = 14695981039346656037ULL;	// FNV-1a
+			for ( const auto s : mStarts ) {
+				hash = ( hash ^ s ) * 1099511628211ULL;
+			}
+			return hash;
+		}
+
+		// memory used by the blocks
+		size_t bytes() const {
+			return nrBlocks() * ( 2 * sizeof( size_t ) + mNrDim * sizeof( SufficientStatistics<T> ) );
+		}
+};
+
+
+#endif
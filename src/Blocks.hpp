@@ -6,6 +6,7 @@ template<typename T>
 class Blocks;
 
 #include "Blocks/BreakpointArray.hpp"
+#include "Blocks/WaveletTree.hpp"
 #include "Blocks/SplittableBlocks.hpp"
 #include "Blocks/FixedBlocks.hpp"
 
@@ -8,16 +8,34 @@
 #include "../Theta.hpp"
 #include "../uintmath.hpp"
 #include "../utils.hpp"
+#include "../Parallel.hpp"
 
 #include <algorithm>
 using std::rotate;
+using std::sort;
+using std::lower_bound;
+using std::inplace_merge;
+using std::partition_point;
 
 #include <deque>
 using std::deque;
 
+#include <cstring>
+using std::memcpy;
+
+#include <utility>
+using std::pair;
+using std::make_pair;
+
 
 
 typedef uint16_t PointerType;
+const PointerType FAR_POINTER = numeric_limits<PointerType>::max();	// marks pointers that are stored in the sparse second level
+typedef uint32_t WeightIndexType;	// positions in the weight index, limiting it to 2^32 data points to halve its memory
+
+const size_t POINTER_CHUNK_SIZE = 1 << 20;	// pointers are computed in chunks of this many positions, which can be processed in parallel
+
+const size_t WEIGHT_INDEX_MAX_DENSITY = 16;	// the weight index is only used if at most every 16th position is a block boundary, otherwise sorting the boundaries is slower than following the pointers
 
 // generates a block structure for any go
 template<>
@@ -35,6 +53,20 @@ class Blocks<BreakpointArray> {
 		// mPointers[i] means that for all j in [i+1, i+mPointers[i]-1] (inclusive), mWeights[j] < mWeights[i]
 		vector<PointerType> mPointers;
 
+		// Pointers of FAR_POINTER or more positions are stored in a sparse second level, sorted by position, so that long stretches of low weights are crossed in a single hop instead of one hop per FAR_POINTER positions. If mPointers[i] == FAR_POINTER, the pointer of i is mFarPointers[k] with mFarPositions[k] == i.
+		vector<size_t> mFarPositions;
+		vector<size_t> mFarPointers;
+
+		// Optional index of all breakpoints [1, mSize) in order of descending weight, NaN first. For a threshold, the boundaries are a prefix of the index, which is found by binary search and sorted into mBoundaries, so creating and enumerating the blocks depends on the number of blocks rather than on the pointer hops between them.
+		vector<WeightIndexType> mWeightIndex;
+		vector<WeightIndexType> mBoundaries;
+		bool mUseBoundaries;	// whether next() reads the block ends from mBoundaries
+		size_t mBoundaryCounter;
+
+		// block size limits, see setBlockLimits()
+		size_t mMinBlockSize;
+		size_t mMaxBlockSize;
+
 		real_t mThreshold;
 		size_t mBlockCounter;
 
@@ -44,10 +76,14 @@ class Blocks<BreakpointArray> {
 		size_t mBlockSize;
 
 
-		// this creates a pointer target to <right> based on the top of the stacks
-		inline void reduceStacks(
-		    deque<size_t>& indexStack,
-		    const size_t& right );
+		// set the pointer of <left> to <right>, using the second level for far pointers
+		inline void setPointer(
+		    const size_t left,
+		    const size_t right,
+		    vector<pair<size_t, size_t>>& farPointers );
+
+		// the pointer of a position i with mPointers[i] == FAR_POINTER
+		size_t farPointer( const size_t i ) const;
 
 	public:
 
@@ -57,14 +93,29 @@ class Blocks<BreakpointArray> {
 
 		// NOTE this constructor swaps its input vectors, i.e. they are empty outsize of this class
 		Blocks(
-		    vector<real_t>& weights );
+		    vector<real_t>& weights,
+		    const size_t nrThreads = 1 );
+
 
+		// Create the weight index, which requires O(T log T) time and 4 bytes per position, but speeds up createBlocks() and next() for well-compressible data.
+		void createWeightIndex();
+
+		// Return the number of breakpoints (excluding position 0) whose weight is not below <threshold> in O(log T), which requires the weight index. NOTE this ignores the block limits, so it only equals the number of blocks minus one if none are set.
+		size_t nrBreakpoints( real_t threshold ) const;
+
+		// Limit the size of blocks to [minSize, maxSize], where maxSize = 0 means no upper limit. Breakpoints closer than minSize to the start of a block are ignored, and blocks longer than maxSize are split at the breakpoint with the largest weight in [start+minSize, start+maxSize].
+		void setBlockLimits(
+		    const size_t minSize,
+		    const size_t maxSize );
 
 		void createBlocks( real_t threshold );
 
 		template<typename ParamType>
 		void createBlocks( const Theta<ParamType>& param );
 
+		// the threshold set by the last call to createBlocks()
+		real_t threshold() const;
+
 		void initForward();
 
 
@@ -78,6 +129,14 @@ class Blocks<BreakpointArray> {
 		// average weight of breakpoints, can be used to derive a block structure for automatic priors for instance
 		real_t avgWeight() const;
 
+		// the position of the largest breakpoint weight in (start, end), i.e. where to split the block [start, end), with ties resolved to the right
+		size_t strongestBreakpoint(
+		    const size_t start,
+		    const size_t end ) const;
+
+		// the weight of the breakpoint between positions i-1 and i
+		real_t weight( const size_t i ) const;
+
 
 		size_t start() const;
 
@@ -110,16 +169,56 @@ class Blocks<BreakpointArray> {
 
 
 
-// this creates a pointer target to <right> based on the top of the stacks
+// set the pointer of <left> to <right>, using the second level for far pointers
+
+inline void Blocks<BreakpointArray>::setPointer(
+    const size_t left,
+    const size_t right,
+    vector<pair<size_t, size_t>>& farPointers ) {
+	if ( right - left < FAR_POINTER ) {
+		mPointers[left] =  right - left;
+	} else {
+		mPointers[left] = FAR_POINTER;
+		farPointers.push_back( make_pair( left, right - left ) );
+	}
+}
+
+
+
+// the pointer of a position i with mPointers[i] == FAR_POINTER
+
+size_t Blocks<BreakpointArray>::farPointer( const size_t i ) const {
+	return mFarPointers[lower_bound( mFarPositions.begin(), mFarPositions.end(), i ) - mFarPositions.begin()];
+}
+
+
+
+// the weight of the breakpoint between positions i-1 and i
+
+real_t Blocks<BreakpointArray>::weight( const size_t i ) const {
+	return mWeights[i];
+}
+
+
 
-inline void Blocks<BreakpointArray>::reduceStacks(
-    deque<size_t>& indexStack,
-    const size_t& right ) {
+// the position of the largest breakpoint weight in (start, end), i.e. where to split the block [start, end), with ties resolved to the right
+// NOTE the pointers from start+1 visit the running maxima of the weights, so the last one before <end> has the largest weight
 
-	// set pointer for stretch
-	size_t left = indexStack.back();
-	mPointers[left] =  right - left;
-	indexStack.pop_back();
+size_t Blocks<BreakpointArray>::strongestBreakpoint(
+    const size_t start,
+    const size_t end ) const {
+	if ( end > mSize || start + 2 > end ) {
+		throw runtime_error( "Block [" + to_string( start ) + ", " + to_string( end ) + ") has no interior breakpoint!" );
+	}
+	size_t split = start + 1;
+	while ( true ) {
+		const PointerType pointer = mPointers[split];
+		const size_t next = split + ( pointer != FAR_POINTER ? pointer : farPointer( split ) );
+		if ( next >= end ) {
+			return split;
+		}
+		split = next;
+	}
 }
 
 
@@ -128,10 +227,15 @@ inline void Blocks<BreakpointArray>::reduceStacks(
 // NOTE this constructor swaps its input vectors, i.e. they are empty outsize of this class
 
 Blocks<BreakpointArray>::Blocks(
-    vector<real_t>& weights
+    vector<real_t>& weights,
+    const size_t nrThreads
 ) :
 	mSize( weights.size() ),
 	mDirection( unset ),
+	mUseBoundaries( false ),
+	mBoundaryCounter( 0 ),
+	mMinBlockSize( 1 ),
+	mMaxBlockSize( numeric_limits<size_t>::max() ),
 	mBlockCounter( 0 ) {
 	// TODO make parameter?
 
@@ -144,41 +248,57 @@ Blocks<BreakpointArray>::Blocks(
 		throw runtime_error( "Input vector for breakpoint weights is empty!" );
 	}
 
-	// calculate pointers
-	// NOTE stacks are implemented without container adapters, since we require random access to indexStack[0]
-	// the maximum value the pointers can take
-	const PointerType maxJumpSize = min( mSize, ( size_t )numeric_limits<PointerType>::max() );
-
-	// initialize all pointers to their maximum allowed value
-	mPointers.assign( mSize, maxJumpSize );
-	deque<size_t> indexStack;
-	indexStack.push_back( 0 );
-	size_t left = 0;
-	for ( size_t right = 1; right < mSize; ++right ) {
-
-		// check if the furthest element in the deque  has reached its maximum jump size, and set its pointer if necessary
-		if ( !indexStack.empty() ) {
-			size_t furthestIndex = indexStack.front();
-			if ( right - furthestIndex == maxJumpSize ) {
-				mPointers[furthestIndex] = maxJumpSize;
-				indexStack.pop_front();
+	// Calculate the pointers with a monotone stack: every position is pushed once, and gets its pointer when a position with at least its weight pops it. The positions are split into chunks that are processed in parallel, each with its own stack. A position that empties the stack of its chunk could also pop positions left over from earlier chunks, so these are recorded and the leftover stacks are merged in order afterwards, which yields the same pointers as a single stack.
+	// NOTE NaN weights never pop nor get popped, so they block the stack exactly as in the sequential version
+	mPointers.assign( mSize, 0 );
+	const size_t nrChunks = ( mSize + POINTER_CHUNK_SIZE - 1 ) / POINTER_CHUNK_SIZE;
+	vector<vector<size_t>> stacks( nrChunks );
+	vector<vector<size_t>> bottoms( nrChunks );	// positions that found the stack of their chunk empty
+	vector<vector<pair<size_t, size_t>>> farPointers( nrChunks + 1 );
+	parallelFor( nrChunks, nrThreads, [&]( size_t c ) {
+		vector<size_t>& stack = stacks[c];
+		const size_t end = min( ( c + 1 ) * POINTER_CHUNK_SIZE, mSize );
+		for ( size_t right = c * POINTER_CHUNK_SIZE; right < end; ++right ) {
+			while ( !stack.empty() && mWeights[stack.back()] <= mWeights[right] ) {
+				setPointer( stack.back(), right, farPointers[c] );
+				stack.pop_back();
+			}
+			if ( stack.empty() ) {
+				bottoms[c].push_back( right );
 			}
+			stack.push_back( right );
 		}
-
-		while ( !indexStack.empty() ) {
-			left = indexStack.back();
-
-			if ( mWeights[left] <= mWeights[right] ) {
-				reduceStacks( indexStack, right );
-			} else {
-				break;	// weights only get larger further down the stack
+	} );
+
+	// merge the leftover stacks, the last vector of far pointers is used for the pointers between chunks
+	vector<size_t> indexStack;
+	for ( size_t c = 0; c < nrChunks; ++c ) {
+		for ( const auto right : bottoms[c] ) {
+			while ( !indexStack.empty() && mWeights[indexStack.back()] <= mWeights[right] ) {
+				setPointer( indexStack.back(), right, farPointers[nrChunks] );
+				indexStack.pop_back();
 			}
 		}
-		indexStack.push_back( right );
+		indexStack.insert( indexStack.end(), stacks[c].begin(), stacks[c].end() );
+		deleteVector( stacks[c] );
+		deleteVector( bottoms[c] );
 	}
 	// elements still on the stack all point past the end
-	while ( indexStack.size() > 0 ) {
-		reduceStacks( indexStack, mSize );
+	for ( const auto left : indexStack ) {
+		setPointer( left, mSize, farPointers[nrChunks] );
+	}
+
+	// far pointers are created out of order
+	vector<pair<size_t, size_t>> allFarPointers;
+	for ( const auto & f : farPointers ) {
+		allFarPointers.insert( allFarPointers.end(), f.begin(), f.end() );
+	}
+	sort( allFarPointers.begin(), allFarPointers.end() );
+	mFarPositions.reserve( allFarPointers.size() );
+	mFarPointers.reserve( allFarPointers.size() );
+	for ( const auto & p : allFarPointers ) {
+		mFarPositions.push_back( p.first );
+		mFarPointers.push_back( p.second );
 	}
 
 };
@@ -186,8 +306,107 @@ Blocks<BreakpointArray>::Blocks(
 
 
 
+void Blocks<BreakpointArray>::createWeightIndex() {
+	if ( mSize - 1 > numeric_limits<WeightIndexType>::max() ) {
+		throw runtime_error( "The weight index only supports up to " + to_string( numeric_limits<WeightIndexType>::max() ) + " data points!" );
+	}
+	// Map each weight to an integer key whose order is descending weight order with NaN first, and sort the positions by key with a stable LSD radix sort, which is much faster than a comparison sort on positions.
+	const size_t n = mSize - 1;
+	vector<uint32_t> keys( n );
+	for ( size_t t = 1; t < mSize; ++t ) {
+		uint32_t bits;
+		const float w = isnan( mWeights[t] ) ? numeric_limits<float>::infinity() : ( float ) mWeights[t];
+		memcpy( &bits, &w, sizeof( bits ) );
+		bits = ( bits & 0x80000000u ) ? ~bits : ( bits | 0x80000000u );
+		keys[t - 1] = ~bits;
+	}
+	mWeightIndex.resize( n );
+	for ( size_t i = 0; i < n; ++i ) {
+		mWeightIndex[i] = i + 1;
+	}
+	vector<uint32_t> keysBuffer( n );
+	vector<WeightIndexType> indexBuffer( n );
+	const size_t digitBits = 11;
+	for ( size_t shift = 0; shift < 32; shift += digitBits ) {
+		vector<size_t> offsets( ( size_t )1 << digitBits, 0 );
+		const uint32_t mask = ( 1u << digitBits ) - 1;
+		for ( size_t i = 0; i < n; ++i ) {
+			offsets[( keys[i] >> shift ) & mask]++;
+		}
+		size_t sum = 0;
+		for ( auto & o : offsets ) {
+			const size_t count = o;
+			o = sum;
+			sum += count;
+		}
+		for ( size_t i = 0; i < n; ++i ) {
+			const size_t j = offsets[( keys[i] >> shift ) & mask]++;
+			keysBuffer[j] = keys[i];
+			indexBuffer[j] = mWeightIndex[i];
+		}
+		keys.swap( keysBuffer );
+		mWeightIndex.swap( indexBuffer );
+	}
+}
+
+
+
+// Return the number of breakpoints (excluding position 0) whose weight is not below <threshold> in O(log T), which requires the weight index. NOTE this ignores the block limits, so it only equals the number of blocks minus one if none are set.
+
+size_t Blocks<BreakpointArray>::nrBreakpoints( real_t threshold ) const {
+	if ( mWeightIndex.size() + 1 != mSize ) {
+		throw runtime_error( "Cannot determine the number of breakpoints for a threshold without the weight index!" );
+	}
+	return ( partition_point( mWeightIndex.begin(), mWeightIndex.end(), [this, threshold]( const WeightIndexType t ) {
+		return !( mWeights[t] < threshold );
+	} ) - mWeightIndex.begin() );
+}
+
+
+
+// Limit the size of blocks to [minSize, maxSize], where maxSize = 0 means no upper limit.
+
+void Blocks<BreakpointArray>::setBlockLimits(
+    const size_t minSize,
+    const size_t maxSize ) {
+	mMinBlockSize = max( minSize, ( size_t ) 1 );
+	mMaxBlockSize = ( maxSize > 0 ? maxSize : numeric_limits<size_t>::max() );
+	if ( mMinBlockSize > mMaxBlockSize ) {
+		throw runtime_error( "Minimum block size must not exceed maximum block size!" );
+	}
+}
+
+
+
 void Blocks<BreakpointArray>::createBlocks( real_t threshold ) {
 	mThreshold = threshold;
+	mUseBoundaries = false;
+	if ( mWeightIndex.size() + 1 == mSize ) {
+		const size_t nrBoundaries = nrBreakpoints( threshold );
+		if ( nrBoundaries * WEIGHT_INDEX_MAX_DENSITY <= mSize ) {
+			// mBoundaries holds the sorted boundaries of the previous threshold, i.e. a prefix of the weight index, so only the difference to the new prefix needs to be sorted and merged
+			const size_t nrOldBoundaries = mBoundaries.size();
+			if ( nrBoundaries > nrOldBoundaries ) {
+				mBoundaries.insert( mBoundaries.end(), mWeightIndex.begin() + nrOldBoundaries, mWeightIndex.begin() + nrBoundaries );
+				sort( mBoundaries.begin() + nrOldBoundaries, mBoundaries.end() );
+				inplace_merge( mBoundaries.begin(), mBoundaries.begin() + nrOldBoundaries, mBoundaries.end() );
+			} else if ( nrBoundaries < nrOldBoundaries ) {
+				vector<WeightIndexType> removed( mWeightIndex.begin() + nrBoundaries, mWeightIndex.begin() + nrOldBoundaries );
+				sort( removed.begin(), removed.end() );
+				size_t r = 0;
+				size_t n = 0;
+				for ( size_t i = 0; i < nrOldBoundaries; ++i ) {
+					if ( r < removed.size() && mBoundaries[i] == removed[r] ) {
+						r++;
+					} else {
+						mBoundaries[n++] = mBoundaries[i];
+					}
+				}
+				mBoundaries.resize( n );
+			}
+			mUseBoundaries = true;
+		}
+	}
 }
 
 
@@ -200,12 +419,21 @@ void Blocks<BreakpointArray>::createBlocks(
 
 
 
+// the threshold set by the last call to createBlocks()
+
+real_t Blocks<BreakpointArray>::threshold() const {
+	return mThreshold;
+}
+
+
+
 void Blocks<BreakpointArray>::initForward() {
 	mDirection = forward;
 	mBlockStart = 0;
 	mBlockEnd = 0;
 	mBlockSize = 0;
 	mBlockCounter = 0;
+	mBoundaryCounter = 0;
 }
 
 
@@ -220,15 +448,29 @@ inline bool Blocks<BreakpointArray>::next() {
 	} else {
 		mBlockCounter++;
 		mBlockStart = mBlockEnd;
-		mBlockEnd = mBlockStart + 1;
-		while ( mBlockEnd < mSize ) {
-			// TODO how to handle overflow. Maximum block size?
-			if ( mWeights[mBlockEnd] < mThreshold ) {
-				mBlockEnd += mPointers[mBlockEnd];	// NOTE this involves typecasting by necessity
-			} else {
-				break;
+		const size_t size = mSize;
+		size_t end = min( mBlockStart + mMinBlockSize, size );
+		if ( mUseBoundaries ) {
+			// skip the boundaries before the minimum block end, which includes the start of this block
+			while ( mBoundaryCounter < mBoundaries.size() && mBoundaries[mBoundaryCounter] < end ) {
+				mBoundaryCounter++;
 			}
+			end = ( mBoundaryCounter < mBoundaries.size() ? mBoundaries[mBoundaryCounter] : size );
+		} else {
+			// NOTE the loop uses local copies, so that the members are not reloaded and stored on every hop. On 2^24 positions with 10% block boundaries, a pass of next() takes about 1.15-1.3 times as long as the bare capped loop in src/benchmarks/breakpointArray.cpp. Dropping the far pointer test only brings this down to about 1.15, so most of the difference comes from updating the iterator state for each block.
+			const real_t* weights = mWeights.data();
+			const PointerType* pointers = mPointers.data();
+			const real_t threshold = mThreshold;
+			while ( end < size && weights[end] < threshold ) {
+				const PointerType pointer = pointers[end];
+				end += ( pointer != FAR_POINTER ? pointer : farPointer( end ) );
+			}
+		}
+		if ( end - mBlockStart > mMaxBlockSize ) {
+			// split at the largest weight in [start+mMinBlockSize, start+mMaxBlockSize]
+			end = strongestBreakpoint( mBlockStart + mMinBlockSize - 1, mBlockStart + mMaxBlockSize + 1 );
 		}
+		mBlockEnd = end;
 		mBlockSize = mBlockEnd - mBlockStart;
 		return true;
 	}
@@ -1,16 +1,29 @@
 #ifndef FIXEDBLOCKS_HPP
 #define FIXEDBLOCKS_HPP
 
+#include "../Blocks.hpp"
+
+#include "../includes.hpp"
+#include "../Tags.hpp"
+#include "../Theta.hpp"
+#include "../utils.hpp"
+
+
+
+// Block structure given by a fixed list of block sizes, e.g. the segments of a previous run. Thresholds are ignored, so every iteration uses the same blocks.
 template<>
 class Blocks<Fixed> {
+
 		// number of input positions
-		const size_t mSize;
-		const vector<size_t>& mSizes;
+		size_t mSize;
+
+		vector<size_t> mSizes;
 
-		size_t mBlockCounter;
-		// the maximum size that an iterator can jump forward (pruning limit)
 		Direction mDirection;
 
+		real_t mThreshold;
+		size_t mBlockCounter;
+
 		// the boundaries of the current block
 		size_t mBlockStart;
 		size_t mBlockEnd;
@@ -22,87 +35,201 @@ class Blocks<Fixed> {
 		Blocks( const Blocks& that ) = delete;
 
 
-		// NOTE this constructor swaps its input vectors, i.e. they are empty outsize of this class
+		// NOTE this constructor swaps its input vector, i.e. it is empty outside of this class
 		Blocks(
-		    vector<size_t>& sizes
-		) :
-			mSizes( sizes ),
-			mBlockCounter( 0 ),
-			mSize( accumulate( sizes.begin(), sizes.end(), 0 ) ),
-			mDirection( unset ),
-			mBlockStart( 0 ),
-			mBlockEnd( 0 ) {
-
-			// check that weights contain data
-			if ( mSize <= 0 ) {
-				throw runtime_error( "Input vector for breakpoint weights is empty!" );
-			}
-		};
+		    vector<size_t>& sizes );
+
+
+		// Fixed blocks cannot be limited, this throws unless the limits are trivial.
+		void setBlockLimits(
+		    const size_t minSize,
+		    const size_t maxSize );
 
+		// the threshold is only recorded, the blocks do not depend on it
+		void createBlocks( real_t threshold );
 
 		template<typename ParamType>
-		void createBlocks( Theta<ParamType>& param );
-
-		void initForward() {
-			mDirection = forward;
-			mBlockStart = 0;
-			mBlockEnd = 0;
-			mBlockSize = 0;
-			mBlockCounter = 0;
-			// initialize block at 0
-		}
+		void createBlocks( const Theta<ParamType>& param );
+
+		// the threshold set by the last call to createBlocks()
+		real_t threshold() const;
+
+		void initForward();
 
 
 
-		// get the end of a block starting at <start> for a given threshold
+		// get the next block from the list of sizes
 		// return false if the block end is the last possible value
-		inline bool next() {
-			if ( mBlockEnd >= mSize ) {
-				mDirection = unset;
-				return false;
-			} else {
-				mBlockStart = mBlockEnd;
-				mBlockEnd = mBlockStart + mSizes[mBlockCounter];
-				mBlockCounter++;
-				mBlockSize = mBlockEnd - mBlockStart;
-				return true;
-			}
-		}
+		inline bool next();
 
 
-		size_t nrBlocks() const {
-			return mSizes.size();
-		}
+		size_t start() const;
 
-		size_t start() const {
-			return mBlockStart;
-		}
+		size_t end() const;
 
-		size_t end() const {
-			return mBlockEnd;
-		}
+		size_t pos() const;
 
-		size_t pos() const {
-			if ( mBlockCounter > 0 ) {
-				return mBlockCounter - 1;
-			} else {
-				throw runtime_error( "No blocks created yet, position is undefined!" );
-			}
-		}
+		// Return the size of the current block.
+		size_t blockSize() const;
 
-		size_t N() const {
-			return mBlockSize ;
-		}
+		// Return the total size, i.e. the sum of all block sizes.
+		size_t size() const;
 
-		size_t T() const {
-			return mSize;
-		}
+		size_t nrBlocks() const;
 
-		void printBlock() const {
-			cout << "[" << mBlockStart << ":" << mBlockEnd << ") " << mBlockSize << " ";
-		}
+
+		void printBlock() const;
 
 
 };
 
+
+
+
+
+
+
+
+
+
+// NOTE this constructor swaps its input vector, i.e. it is empty outside of this class
+
+Blocks<Fixed>::Blocks(
+    vector<size_t>& sizes
+) :
+	mSize( 0 ),
+	mDirection( unset ),
+	mThreshold( 0 ),
+	mBlockCounter( 0 ),
+	mBlockStart( 0 ),
+	mBlockEnd( 0 ),
+	mBlockSize( 0 ) {
+
+	mSizes.swap( sizes );
+	for ( const auto s : mSizes ) {
+		if ( s == 0 ) {
+			throw runtime_error( "Fixed blocks must not be empty!" );
+		}
+		mSize += s;
+	}
+
+	// check that sizes contain data
+	if ( mSize <= 0 ) {
+		throw runtime_error( "Input vector for block sizes is empty!" );
+	}
+};
+
+
+
+
+void Blocks<Fixed>::setBlockLimits(
+    const size_t minSize,
+    const size_t maxSize ) {
+	if ( minSize > 1 || maxSize > 0 ) {
+		throw runtime_error( "Block limits cannot be applied to fixed blocks!" );
+	}
+}
+
+
+
+void Blocks<Fixed>::createBlocks( real_t threshold ) {
+	mThreshold = threshold;
+}
+
+
+
+// fixed blocks do not depend on the emission parameters
+template<>
+void Blocks<Fixed>::createBlocks(
+    const  Theta<NormalParam>& param ) {
+}
+
+
+
+// the threshold set by the last call to createBlocks()
+
+real_t Blocks<Fixed>::threshold() const {
+	return mThreshold;
+}
+
+
+
+void Blocks<Fixed>::initForward() {
+	mDirection = forward;
+	mBlockStart = 0;
+	mBlockEnd = 0;
+	mBlockSize = 0;
+	mBlockCounter = 0;
+}
+
+
+
+// get the next block from the list of sizes
+// return false if the block end is the last possible value
+
+inline bool Blocks<Fixed>::next() {
+	if ( mBlockEnd >= mSize ) {
+		mDirection = unset;
+		return false;
+	} else {
+		mBlockStart = mBlockEnd;
+		mBlockSize = mSizes[mBlockCounter];
+		mBlockEnd = mBlockStart + mBlockSize;
+		mBlockCounter++;
+		return true;
+	}
+}
+
+
+
+size_t Blocks<Fixed>::start() const {
+	return mBlockStart;
+}
+
+
+
+size_t Blocks<Fixed>::end() const {
+	return mBlockEnd;
+}
+
+
+
+size_t Blocks<Fixed>::pos() const {
+	if ( mBlockCounter > 0 ) {
+		return mBlockCounter - 1;
+	} else {
+		throw runtime_error( "No blocks created yet, position is undefined!" );
+	}
+}
+
+
+
+// Return the size of the current block.
+
+size_t Blocks<Fixed>::blockSize() const {
+	return mBlockSize;
+}
+
+
+
+// Return the total size, i.e. the sum of all block sizes.
+
+size_t Blocks<Fixed>::size() const {
+	return mSize;
+}
+
+
+
+// Return the number of blocks, which does not depend on the threshold.
+
+size_t Blocks<Fixed>::nrBlocks() const {
+	return mSizes.size();
+}
+
+
+
+void Blocks<Fixed>::printBlock() const {
+	cout << "[" << mBlockStart << ":" << mBlockEnd << ") " << mBlockSize << " ";
+}
+
 #endif
@@ -1,131 +1,288 @@
 #ifndef SPLITTABLEBLOCKS_HPP
 #define SPLITTABLEBLOCKS_HPP
 
+#include "../Blocks.hpp"
+
+#include "../includes.hpp"
+#include "../Tags.hpp"
+#include "../Theta.hpp"
+#include "../utils.hpp"
+#include "BreakpointArray.hpp"
+
+
+
+// Block structure for coarse-to-fine sampling. It starts from the blocks of a breakpoint array for a high threshold, and selected blocks can be split at their strongest interior breakpoint, so that only ambiguous regions are refined. Thresholds are ignored otherwise.
 template<>
 class Blocks<Splittable> {
+
+		// the breakpoint weights used to decide where to split
+		Blocks<BreakpointArray>& mBreakpoints;
+
+		// number of input positions
 		const size_t mSize;
-		deque<size_t> mSizes;
-		size_t mStart;
-		size_t mEnd;
-		size_t mPos;	// the current position as seen from the outside.
-		size_t mIndex; // the index in mSizes corresponding to mPos
-		bool mFirstIter;
-
-		void rotate() {
-			mSizes.push_back( mSizes.front() );
-			mSizes.pop_front();
-			if ( mIndex > 0 ) {
-				mIndex--;
-			} else {
-				mIndex = mSizes.size() - 1;
-			}
-		}
+
+		vector<size_t> mSizes;
+
+		Direction mDirection;
+
+		real_t mThreshold;
+		size_t mBlockCounter;
+
+		// the boundaries of the current block
+		size_t mBlockStart;
+		size_t mBlockEnd;
+		size_t mBlockSize;
 
 	public:
 
+		// delete copy constructor
+		Blocks( const Blocks& that ) = delete;
 
-		Blocks( size_t size ):
-			mSize( size ),
-			mPos( 0 ),
-			mStart( 0 ),
-			mEnd( 0 ),
-			mIndex( 0 ),
-			mFirstIter( true ) {
-			if ( size == 0 ) {
-				throw runtime_error( "Cannot create block structure for 0 positions!" );
-			}
-			mSizes.push_back( size );
-		}
 
-		// TODO is there any way to swap this?
-		Blocks( const vector<size_t>& sizes ):
-			mSize( accumulate( sizes.begin(), sizes.end(), 0 ) ),
-			mPos( 0 ),
-			mStart( 0 ),
-			mEnd( 0 ),
-			mIndex( 0 ),
-			mFirstIter( true ) {
-			for ( auto & x : sizes ) {
-				mSizes.push_back( x );
-			}
-		}
+		// start with the blocks of <breakpoints> for <threshold>
+		Blocks(
+		    Blocks<BreakpointArray>& breakpoints,
+		    const real_t threshold );
+
+
+		// the weight of the strongest interior breakpoint of each block, i.e. the weight that split() would remove, or -inf for blocks of size 1
+		vector<real_t> splitWeights() const;
+
+		// Split each block b with selected[b] == true and a size of at least 2 at its strongest interior breakpoint, and return the number of blocks that were split.
+		size_t split( const vector<bool>& selected );
+
+		// Splittable blocks cannot be limited, this throws unless the limits are trivial.
+		void setBlockLimits(
+		    const size_t minSize,
+		    const size_t maxSize );
+
+		// the threshold is only recorded, the blocks do not depend on it
+		void createBlocks( real_t threshold );
+
+		template<typename ParamType>
+		void createBlocks( const Theta<ParamType>& param );
+
+		// the threshold set by the last call to createBlocks()
+		real_t threshold() const;
+
+		void initForward();
+
+
+
+		// get the next block from the list of sizes
+		// return false if the block end is the last possible value
+		inline bool next();
+
+
+		size_t start() const;
+
+		size_t end() const;
+
+		size_t pos() const;
+
+		// Return the size of the current block.
+		size_t blockSize() const;
+
+		// Return the total size, i.e. the sum of all block sizes.
+		size_t size() const;
+
+		size_t nrBlocks() const;
+
+
+		void printBlock() const;
+
+
+};
+
+
+
+
+
+
+
+
+
+
+// start with the blocks of <breakpoints> for <threshold>
+
+Blocks<Splittable>::Blocks(
+    Blocks<BreakpointArray>& breakpoints,
+    const real_t threshold
+) :
+	mBreakpoints( breakpoints ),
+	mSize( breakpoints.size() ),
+	mDirection( unset ),
+	mThreshold( threshold ),
+	mBlockCounter( 0 ),
+	mBlockStart( 0 ),
+	mBlockEnd( 0 ),
+	mBlockSize( 0 ) {
+
+	mBreakpoints.createBlocks( threshold );
+	mBreakpoints.initForward();
+	while ( mBreakpoints.next() ) {
+		mSizes.push_back( mBreakpoints.blockSize() );
+	}
+};
+
 
-		// Split the current block such that the first new block is of size s, and move to the first block; this preserves pos(). If s is >= the size of the block, an exception is thrown
-		void split( size_t s ) {
-			if ( mSizes[mIndex] <= s ) {
-				throw runtime_error( "Cannot split block into this size!" );
-			}
-
-			// rotate until current position is at the front
-			while ( mIndex != 0 ) {
-				rotate();
-			}
-
-			mSizes.push_back( s );
-			mSizes[0] = mSizes[0] - s;
-			mIndex = mSizes.size() - 1;
-		};
-
-
-		// Move to the first position, so pos()==0.
-		void initForward() {
-			mFirstIter = true;
-			if ( mIndex >= mPos ) {
-				mIndex -= mPos;
-			} else {
-				mIndex += ( mSizes.size() - mPos );
-			}
-			mPos = 0;
-			mStart = 0;
-			mEnd = 0;
-		}
 
-		// move to the next block, in modular fashion (wrap around)
-		// returns false if wrapped around, otherwise true.
-		bool next() {
-			if ( mFirstIter ) {
-				mFirstIter = false;
-				mEnd = mStart + mSizes[mIndex];
-			} else {
-				mIndex = ( mIndex + 1 ) % mSizes.size();
-				mPos++;
-				mStart = mEnd;
-				mEnd += mSizes[mIndex];
-			}
-			if ( mPos == mSizes.size() ) {
-				mPos = 0;
-				return false;
-			} else {
-				return true;
-			}
-		};
-
-		size_t start() const {
-			return mStart;
+
+// the weight of the strongest interior breakpoint of each block, i.e. the weight that split() would remove, or -inf for blocks of size 1
+
+vector<real_t> Blocks<Splittable>::splitWeights() const {
+	vector<real_t> weights;
+	weights.reserve( mSizes.size() );
+	size_t start = 0;
+	for ( const auto s : mSizes ) {
+		if ( s > 1 ) {
+			weights.push_back( mBreakpoints.weight( mBreakpoints.strongestBreakpoint( start, start + s ) ) );
+		} else {
+			weights.push_back( -inf );
 		}
+		start += s;
+	}
+	return weights;
+}
+
 
-		size_t end() const {
-			return mEnd;
+
+// Split each block b with selected[b] == true and a size of at least 2 at its strongest interior breakpoint, and return the number of blocks that were split.
+
+size_t Blocks<Splittable>::split( const vector<bool>& selected ) {
+	if ( selected.size() != mSizes.size() ) {
+		throw runtime_error( "Number of blocks to split does not match number of blocks!" );
+	}
+	vector<size_t> sizes;
+	sizes.reserve( mSizes.size() );
+	size_t nrSplits = 0;
+	size_t start = 0;
+	for ( size_t b = 0; b < mSizes.size(); ++b ) {
+		const size_t end = start + mSizes[b];
+		if ( selected[b] && mSizes[b] > 1 ) {
+			const size_t s = mBreakpoints.strongestBreakpoint( start, end );
+			sizes.push_back( s - start );
+			sizes.push_back( end - s );
+			nrSplits++;
+		} else {
+			sizes.push_back( mSizes[b] );
 		}
+		start = end;
+	}
+	mSizes.swap( sizes );
+	return nrSplits;
+}
 
 
-		// return the number of blocks
-		size_t nrBlocks()const {
-			return mSizes.size();
-		};
 
+void Blocks<Splittable>::setBlockLimits(
+    const size_t minSize,
+    const size_t maxSize ) {
+	if ( minSize > 1 || maxSize > 0 ) {
+		throw runtime_error( "Block limits cannot be applied to splittable blocks!" );
+	}
+}
 
-		// return the current block size
-		size_t size() const {
-			return mSizes[mIndex];
-		};
 
 
-		// return the index of the current block
-		size_t pos() const {
-			return mPos % mSizes.size();
-		}
-};
+void Blocks<Splittable>::createBlocks( real_t threshold ) {
+	mThreshold = threshold;
+}
+
+
+
+// splittable blocks only change through split()
+template<>
+void Blocks<Splittable>::createBlocks(
+    const  Theta<NormalParam>& param ) {
+}
+
+
+
+// the threshold set by the last call to createBlocks()
+
+real_t Blocks<Splittable>::threshold() const {
+	return mThreshold;
+}
+
+
+
+void Blocks<Splittable>::initForward() {
+	mDirection = forward;
+	mBlockStart = 0;
+	mBlockEnd = 0;
+	mBlockSize = 0;
+	mBlockCounter = 0;
+}
+
+
+
+// get the next block from the list of sizes
+// return false if the block end is the last possible value
+
+inline bool Blocks<Splittable>::next() {
+	if ( mBlockEnd >= mSize ) {
+		mDirection = unset;
+		return false;
+	} else {
+		mBlockStart = mBlockEnd;
+		mBlockSize = mSizes[mBlockCounter];
+		mBlockEnd = mBlockStart + mBlockSize;
+		mBlockCounter++;
+		return true;
+	}
+}
+
+
+
+size_t Blocks<Splittable>::start() const {
+	return mBlockStart;
+}
+
+
+
+size_t Blocks<Splittable>::end() const {
+	return mBlockEnd;
+}
+
+
+
+size_t Blocks<Splittable>::pos() const {
+	if ( mBlockCounter > 0 ) {
+		return mBlockCounter - 1;
+	} else {
+		throw runtime_error( "No blocks created yet, position is undefined!" );
+	}
+}
+
+
+
+// Return the size of the current block.
+
+size_t Blocks<Splittable>::blockSize() const {
+	return mBlockSize;
+}
+
+
+
+// Return the total size, i.e. the sum of all block sizes.
+
+size_t Blocks<Splittable>::size() const {
+	return mSize;
+}
+
+
+
+// Return the number of blocks, which only changes through split().
+
+size_t Blocks<Splittable>::nrBlocks() const {
+	return mSizes.size();
+}
+
+
 
+void Blocks<Splittable>::printBlock() const {
+	cout << "[" << mBlockStart << ":" << mBlockEnd << ") " << mBlockSize << " ";
+}
 
 #endif
@@ -0,0 +1,263 @@
+#ifndef WAVELETTREE_HPP
+#define WAVELETTREE_HPP
+
+#include "../Blocks.hpp"
+
+#include "../includes.hpp"
+#include "../Tags.hpp"
+#include "../Theta.hpp"
+#include "../uintmath.hpp"
+#include "../utils.hpp"
+
+
+
+// Block structure of aligned dyadic nodes [s, s+2^k), i.e. the classic HaMMLET wavelet tree. Each node stores the maximum of all breakpoint weights in its interior at its midpoint s+2^(k-1), so a single array of mSize weights replaces the weights and pointers of Blocks<BreakpointArray>. A block is the largest node starting at the current position whose interior weights are all below the threshold, which is found by descending from the largest candidate node, typically with a single memory access for large blocks. Compared to Blocks<BreakpointArray>, blocks never cross the boundaries of larger nodes, so the same threshold can yield more (but aligned) blocks.
+template<>
+class Blocks<WaveletTree> {
+
+		// number of input positions
+		const size_t mSize;
+
+		Direction mDirection;
+
+		// mMaxima[s+2^(k-1)] is the maximum breakpoint weight in the interior of the node [s, s+2^k), for nodes completely inside [0, mSize). Since every position except 0 and the greedy starts of the maxlet transform is the midpoint of exactly one such node, nodes of size 2 keep their original weight mMaxima[s+1] = w[s+1].
+		vector<real_t> mMaxima;
+
+		// block size limits, see setBlockLimits()
+		size_t mMinBlockSize;
+		size_t mMaxNodeSize;
+
+		real_t mThreshold;
+		size_t mBlockCounter;
+
+		// the boundaries of the current block
+		size_t mBlockStart;
+		size_t mBlockEnd;
+		size_t mBlockSize;
+
+	public:
+
+		// NOTE this constructor swaps its input vectors, i.e. they are empty outsize of this class
+		Blocks(
+		    vector<real_t>& weights );
+
+
+		// Limit the size of blocks to [minSize, maxSize], where maxSize = 0 means no upper limit. Nodes are only split if both children are at least minSize long, unless the largest node starting at a position is already shorter, and nodes are at most the largest power of 2 not exceeding maxSize.
+		void setBlockLimits(
+		    const size_t minSize,
+		    const size_t maxSize );
+
+		void createBlocks( real_t threshold );
+
+		template<typename ParamType>
+		void createBlocks( const Theta<ParamType>& param );
+
+		// the threshold set by the last call to createBlocks()
+		real_t threshold() const;
+
+		void initForward();
+
+
+
+		// get the largest node starting at the end of the current block whose interior weights are below the threshold
+		// return false if the block end is the last possible value
+		inline bool next();
+
+
+		size_t start() const;
+
+		size_t end() const;
+
+		size_t pos() const;
+
+		// Return the size of the current block.
+		size_t blockSize() const;
+
+		// Return the total size, i.e. the sum of all block sizes.
+		size_t size() const;
+
+		size_t nrBlocks() const;
+
+
+		void printBlock() const;
+
+
+};
+
+
+
+
+
+
+
+
+
+
+
+
+// NOTE this constructor swaps its input vectors, i.e. they are empty outsize of this class
+
+Blocks<WaveletTree>::Blocks(
+    vector<real_t>& weights
+) :
+	mSize( weights.size() ),
+	mDirection( unset ),
+	mMinBlockSize( 1 ),
+	mMaxNodeSize( numeric_limits<size_t>::max() ),
+	mBlockCounter( 0 ) {
+
+	mMaxima.swap( weights );
+
+	// check that weights contain data
+	if ( mSize <= 0 ) {
+		throw runtime_error( "Input vector for breakpoint weights is empty!" );
+	}
+
+	// Propagate the maxima bottom-up: the interior of a node consists of its midpoint and the interiors of its children, whose midpoints are at distance <quarter>. NaN is propagated so that it forces a split, like in Blocks<BreakpointArray>.
+	auto propagate = []( real_t & m, const real_t c ) {
+		if ( isnan( c ) || c > m ) {
+			m = c;
+		}
+	};
+	for ( size_t nodeSize = 4; nodeSize <= mSize; nodeSize *= 2 ) {
+		const size_t half = nodeSize / 2;
+		const size_t quarter = nodeSize / 4;
+		for ( size_t mid = half; mid + half <= mSize; mid += nodeSize ) {
+			propagate( mMaxima[mid], mMaxima[mid - quarter] );
+			propagate( mMaxima[mid], mMaxima[mid + quarter] );
+		}
+	}
+};
+
+
+
+
+// Limit the size of blocks to [minSize, maxSize], where maxSize = 0 means no upper limit.
+
+void Blocks<WaveletTree>::setBlockLimits(
+    const size_t minSize,
+    const size_t maxSize ) {
+	mMinBlockSize = max( minSize, ( size_t ) 1 );
+	mMaxNodeSize = ( maxSize > 0 ? floorPow2( maxSize ) : numeric_limits<size_t>::max() );
+	if ( maxSize > 0 && mMinBlockSize > maxSize ) {
+		throw runtime_error( "Minimum block size must not exceed maximum block size!" );
+	}
+}
+
+
+
+void Blocks<WaveletTree>::createBlocks( real_t threshold ) {
+	mThreshold = threshold;
+}
+
+
+// same threshold as for Blocks<BreakpointArray>
+template<>
+void Blocks<WaveletTree>::createBlocks(
+    const  Theta<NormalParam>& param ) {
+	createBlocks( sqrt( 2 * log( ( real_t )mSize ) *param.thresholdValue() ) );
+}
+
+
+
+// the threshold set by the last call to createBlocks()
+
+real_t Blocks<WaveletTree>::threshold() const {
+	return mThreshold;
+}
+
+
+
+void Blocks<WaveletTree>::initForward() {
+	mDirection = forward;
+	mBlockStart = 0;
+	mBlockEnd = 0;
+	mBlockSize = 0;
+	mBlockCounter = 0;
+}
+
+
+
+// get the largest node starting at the end of the current block whose interior weights are below the threshold
+// return false if the block end is the last possible value
+
+inline bool Blocks<WaveletTree>::next() {
+	if ( mBlockEnd >= mSize ) {
+		mDirection = unset;
+		return false;
+	} else {
+		mBlockCounter++;
+		mBlockStart = mBlockEnd;
+
+		// the largest aligned node that starts here and fits into the input
+		size_t size = min( floorPow2( mSize - mBlockStart ), mMaxNodeSize );
+		if ( mBlockStart > 0 ) {
+			size = min( size, klb( mBlockStart ) );
+		}
+
+		// NOTE the comparison is negated so that NaN weights cause a split, like in Blocks<BreakpointArray>
+		while ( size / 2 >= mMinBlockSize && !( mMaxima[mBlockStart + size / 2] < mThreshold ) ) {
+			size /= 2;
+		}
+		mBlockSize = size;
+		mBlockEnd = mBlockStart + size;
+		return true;
+	}
+}
+
+
+
+size_t Blocks<WaveletTree>::start() const {
+	return mBlockStart;
+}
+
+
+
+size_t Blocks<WaveletTree>::end() const {
+	return mBlockEnd;
+}
+
+
+
+size_t Blocks<WaveletTree>::pos() const {
+	if ( mBlockCounter > 0 ) {
+		return mBlockCounter - 1;
+	} else {
+		throw runtime_error( "No blocks created yet, position is undefined!" );
+	}
+}
+
+
+
+// Return the size of the current block.
+
+size_t Blocks<WaveletTree>::blockSize() const {
+	return mBlockSize ;
+}
+
+
+
+// Return the total size, i.e. the sum of all block sizes.
+
+size_t Blocks<WaveletTree>::size() const {
+	return mSize;
+}
+
+
+
+// Return the number of blocks induced by the current threshold. This can only be called once the iteration is complete.
+
+size_t Blocks<WaveletTree>::nrBlocks() const {
+	if ( mDirection != unset ) {
+		throw runtime_error( "Cannot determine size of block structure before all blocks have been seen!" );
+	}
+	return mBlockCounter;
+}
+
+
+
+void Blocks<WaveletTree>::printBlock() const {
+	cout << "[" << mBlockStart << ":" << mBlockEnd << ") " << mBlockSize << " ";
+}
+
+#endif
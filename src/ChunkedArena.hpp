@@ -0,0 +1,101 @@
+#ifndef CHUNKEDARENA_HPP
+#define CHUNKEDARENA_HPP
+
+#include "includes.hpp"
+#include "utils.hpp"
+
+
+const size_t SLAB_SIZE = 1 << 20;	// number of elements per slab after the first one
+
+
+// Collects an unknown number of elements in a list of fixed-size slabs, so appending never reallocates or copies existing elements. Once all elements are collected, they are moved into a single contiguous vector with the exact final size. If the first slab was large enough to hold all elements, it is adopted without copying. Otherwise the elements are copied into a vector that is reserved but not initialized, so its memory pages are only committed as they are written, and the pages of each slab are returned to the operating system as soon as they are copied, so resident memory exceeds the final size by at most one slab, even if the first slab was sized from an estimate that turned out slightly too small and holds almost all elements.
+template <typename T>
+class ChunkedArena {
+
+		vector<vector<T>> mSlabs;
+		size_t mFirstSlabSize;
+		size_t mSize;
+
+	public:
+
+		// delete copy constructor
+		ChunkedArena( const ChunkedArena& that ) = delete;
+
+		// <firstSlabSize> is the capacity of the first slab, which should be set to the expected total size (if known) so that the slab can be adopted in moveTo()
+		ChunkedArena(
+		    const size_t firstSlabSize = 0 ) :
+			mSlabs( 1 ),
+			mFirstSlabSize( firstSlabSize > 0 ? firstSlabSize : SLAB_SIZE ),
+			mSize( 0 ) {
+			mSlabs[0].reserve( mFirstSlabSize );
+		}
+
+		inline void push_back( const T& x ) {
+			if ( mSlabs.back().size() == ( mSlabs.size() == 1 ? mFirstSlabSize : SLAB_SIZE ) ) {
+				mSlabs.push_back( vector<T>() );
+				mSlabs.back().reserve( SLAB_SIZE );
+			}
+			mSlabs.back().push_back( x );
+			mSize++;
+		}
+
+		// Append <n> default-constructed elements, which can then be set via operator[], also from several threads as long as each element is only written by one of them.
+		void grow( size_t n ) {
+			while ( n > 0 ) {
+				if ( mSlabs.back().size() == ( mSlabs.size() == 1 ? mFirstSlabSize : SLAB_SIZE ) ) {
+					mSlabs.push_back( vector<T>() );
+					mSlabs.back().reserve( SLAB_SIZE );
+				}
+				const size_t k = min( n, ( mSlabs.size() == 1 ? mFirstSlabSize : SLAB_SIZE ) - mSlabs.back().size() );
+				mSlabs.back().resize( mSlabs.back().size() + k );
+				mSize += k;
+				n -= k;
+			}
+		}
+
+		inline T& operator[]( const size_t i ) {
+			if ( i < mFirstSlabSize ) {
+				return mSlabs[0][i];
+			}
+			const size_t j = i - mFirstSlabSize;
+			return mSlabs[1 + j / SLAB_SIZE][j % SLAB_SIZE];
+		}
+
+		size_t size() const {
+			return mSize;
+		}
+
+		// Move all elements into the empty vector <out>, leaving capacity for at least <extraCapacity> more elements. The arena is empty afterwards.
+		void moveTo(
+		    vector<T>& out,
+		    const size_t extraCapacity = 0 ) {
+
+			if ( out.size() > 0 ) {
+				throw runtime_error( "Target vector for chunked arena must be empty!" );
+			}
+
+			if ( mSlabs.size() == 1 && mFirstSlabSize >= mSize + extraCapacity ) {
+				out.swap( mSlabs[0] );
+				vector<T>().swap( mSlabs[0] );
+			} else {
+				vector<T>().swap( out );
+				out.reserve( mSize + extraCapacity );
+				for ( auto & slab : mSlabs ) {
+					// NOTE the first slab may be almost as large as the output, so it is released in pieces while copying
+					for ( size_t i = 0; i < slab.size(); i += SLAB_SIZE ) {
+						const size_t end = min( i + SLAB_SIZE, slab.size() );
+						out.insert( out.end(), slab.begin() + i, slab.begin() + end );
+						releasePages( slab.data() + i, slab.data() + end );
+					}
+					deleteVector( slab );
+				}
+			}
+			mSlabs.resize( 1 );
+			mFirstSlabSize = 0;
+			mSize = 0;
+		}
+
+};
+
+
+#endif
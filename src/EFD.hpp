@@ -5,6 +5,7 @@
 
 #include "SufficientStatistics.hpp"
 #include "Observation.hpp"
+#include "MultiVector.hpp"
 
 
 ////////// Inner Products of parameters and sufficient statistics //////////
@@ -32,6 +33,30 @@ real_t innerProduct(
 }
 
 
+// Add the inner products of positions [first, first+count) of dimension <dim> of <stats> with <param> to <result>. The components are read from contiguous arrays, and the blocks are independent, so the loop can be vectorized.
+void addInnerProducts(
+    const MultiVector<SufficientStatistics<Normal>>& stats,
+    const size_t dim,
+    const size_t first,
+    const size_t count,
+    const Observation<NormalParam>& param,
+    real_t* result ) {
+	const real_t* sums = stats.sums( dim ) + first;
+	const real_t* sumSqs = stats.sumSqs( dim ) + first;
+	const double mean = param.mean();
+	const double var = param.var();
+	int finite = 1;	// NOTE isfinite() and bool prevent vectorization, NaN fails the comparison as well
+	for ( size_t i = 0; i < count; ++i ) {
+		const real_t product = ( 2.0 * mean * sums[i] - sumSqs[i] ) / ( 2.0 * var );
+		finite &= ( abs( product ) <= numeric_limits<real_t>::max() );
+		result[i] += product;
+	}
+	if ( !finite ) {
+		throw runtime_error( "Result of Normal inner product is not finite!" );
+	}
+}
+
+
 real_t logNormalizer(
     const Observation<NormalParam>& param ) {
 	return log( param.stdev() ) + param.mean() * param.mean() / ( 2 * param.var() );
@@ -79,6 +104,22 @@ real_t logNormalizer(
 
 
 
+// Add the inner products of positions [first, first+count) of dimension <dim> of <stats> with <param> to <result>, one position at a time.
+template<class SuffStatType, class ParamType>
+void addInnerProducts(
+    const MultiVector<SufficientStatistics<SuffStatType>>& stats,
+    const size_t dim,
+    const size_t first,
+    const size_t count,
+    const Observation<ParamType>& param,
+    real_t* result ) {
+	for ( size_t i = 0; i < count; ++i ) {
+		result[i] += innerProduct( stats.get( first + i, dim ), param );
+	}
+}
+
+
+
 // calculates the inner product in the PDF of an EFD between the current sufficient statistics and a set of parameters under a current mapping
 template<class EmissionObject, class ParamType>
 real_t innerProduct(
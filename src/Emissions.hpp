@@ -5,15 +5,141 @@
 #include "Tags.hpp"
 #include "Blocks.hpp"
 #include "Statistics.hpp"
+#include "BlockTable.hpp"
 
+#include <list>
+using std::list;
 
-// A wrapper around a combination of a data structure holding data points/sufficient statistics and an associated block structure
+
+const real_t BLOCK_BUDGET_PRECISION = 0.001;	// relative precision of the threshold found by Emissions::setMaxBlocks()
+
+
+// A wrapper around a combination of a data structure holding data points/sufficient statistics and an associated block structure. Whenever blocks are created, they are materialized into a BlockTable with their statistics, which samplers can iterate over repeatedly.
 template<typename S, typename T, typename B>
 class Emissions<Statistics<S, T>, Blocks<B>> {
 
 		Statistics<S, T>& mStats;
 		Blocks<B>& mBlocks;
 
+		// the materialized blocks for the current threshold, unless they come from the cache
+		BlockTable<T> mTable;
+
+		// A block structure materialized for one cell of the threshold grid.
+		struct CachedBlocks {
+			long cell;
+			BlockTable<T> table;
+
+			CachedBlocks(
+			    const long c,
+			    const size_t nrDim ) :
+				cell( c ),
+				table( nrDim ) {}
+		};
+
+		// Optional LRU cache of block structures, most recently used first, see setBlockCache().
+		real_t mCacheStep;	// width of a grid cell in log-threshold space, 0 if the cache is disabled
+		size_t mCacheCapacity;	// in bytes
+		size_t mCacheBytes;
+		list<CachedBlocks> mCache;
+		size_t mCacheHits;
+		size_t mCacheMisses;
+
+		// lower bound for all thresholds, so that the number of blocks stays within the budget given to setMaxBlocks()
+		real_t mMinThreshold;
+
+		// Optional automatic switch to static blocks, see setAutoStatic().
+		size_t mStableLimit;	// number of unchanged iterations after which the blocks are frozen, 0 if disabled
+		real_t mStableTolerance;	// relative change in the number of blocks that still counts as unchanged, 0 requires identical blocks
+		size_t mStableIterations;
+		size_t mLastNrBlocks;	// for a positive tolerance, the number of blocks at the start of the current stable stretch
+		uint64_t mLastHash;
+		bool mFrozen;
+
+		// the table of the current block structure, either mTable or a cache entry
+		const BlockTable<T>* mCurrent;
+		size_t mPos;	// number of blocks seen in the current iteration
+
+
+		// iterate over the block structure for the current threshold and store it in <table>
+		void materialize( BlockTable<T>& table ) {
+			table.clear();
+			mBlocks.initForward();
+			while ( mBlocks.next() ) {
+				mStats.setStats( mBlocks );
+				table.push_back( mBlocks, mStats );
+			}
+			mCurrent = &table;
+			mPos = 0;
+		}
+
+
+		// materialize the block structure for the current threshold into a new cache entry for <cell>, evicting the least recently used entries to stay within the capacity
+		void cacheBlocks( const long cell ) {
+			materialize( mTable );
+			if ( mTable.bytes() > mCacheCapacity ) {
+				return;	// too large to be cached, use mTable instead
+			}
+			while ( mCacheBytes + mTable.bytes() > mCacheCapacity ) {
+				mCacheBytes -= mCache.back().table.bytes();
+				mCache.pop_back();
+			}
+			mCache.emplace_front( cell, mStats.nrDim() );
+			std::swap( mCache.front().table, mTable );
+			mCacheBytes += mCache.front().table.bytes();
+			mCurrent = &mCache.front().table;
+		}
+
+
+		// use the cached blocks for <cell>, or materialize them into a new cache entry
+		void lookupBlocks( const long cell ) {
+			for ( auto it = mCache.begin(); it != mCache.end(); ++it ) {
+				if ( it->cell == cell ) {
+					mCache.splice( mCache.begin(), mCache, it );
+					mCurrent = &mCache.front().table;
+					mPos = 0;
+					mCacheHits++;
+					return;
+				}
+			}
+			mCacheMisses++;
+			cacheBlocks( cell );
+		}
+
+
+		// number of blocks for <threshold>, without materializing them
+		size_t countBlocks( const real_t threshold ) {
+			mBlocks.createBlocks( threshold );
+			mBlocks.initForward();
+			while ( mBlocks.next() ) {
+			}
+			return mBlocks.nrBlocks();
+		}
+
+
+		// count the iterations in which the block structure has not changed, and freeze it once there are mStableLimit of them
+		void trackStability() {
+			if ( mStableLimit == 0 ) {
+				return;
+			}
+			const size_t nrBlocks = mCurrent->nrBlocks();
+			bool unchanged;
+			if ( mStableTolerance > 0 ) {
+				const real_t difference = abs( ( real_t ) nrBlocks - ( real_t ) mLastNrBlocks );
+				unchanged = ( mLastNrBlocks > 0 && difference <= mStableTolerance * mLastNrBlocks );
+			} else {
+				const uint64_t hash = mCurrent->boundaryHash();
+				unchanged = ( nrBlocks == mLastNrBlocks && hash == mLastHash );
+				mLastHash = hash;
+			}
+			if ( unchanged ) {
+				mStableIterations++;
+				mFrozen = ( mStableIterations >= mStableLimit );
+			} else {
+				mStableIterations = 0;
+				mLastNrBlocks = nrBlocks;
+			}
+		}
+
 	public:
 
 		Emissions(
@@ -21,7 +147,22 @@ class Emissions<Statistics<S, T>, Blocks<B>> {
 		    Blocks<B>& blocks
 		):
 			mStats( stats ),
-			mBlocks( blocks ) {
+			mBlocks( blocks ),
+			mTable( stats.nrDim() ),
+			mCacheStep( 0 ),
+			mCacheCapacity( 0 ),
+			mCacheBytes( 0 ),
+			mCacheHits( 0 ),
+			mCacheMisses( 0 ),
+			mMinThreshold( 0 ),
+			mStableLimit( 0 ),
+			mStableTolerance( 0 ),
+			mStableIterations( 0 ),
+			mLastNrBlocks( 0 ),
+			mLastHash( 0 ),
+			mFrozen( false ),
+			mCurrent( nullptr ),
+			mPos( 0 ) {
 			if ( mStats.size() != mBlocks.size() ) {
 				throw runtime_error( "Block structure and statistics have different number of data points!" );
 			}
@@ -46,19 +187,135 @@ class Emissions<Statistics<S, T>, Blocks<B>> {
 		}
 
 
+		// the materialized blocks of the current block structure
+		const BlockTable<T>& blockTable() const {
+			if ( mCurrent == nullptr ) {
+				throw runtime_error( "No blocks created yet!" );
+			}
+			return *mCurrent;
+		}
+
+
+		// Enable the block cache. Thresholds derived from theta are rounded down to the grid 1, r, r^2, ... with r = 1 + <cellWidth>, and the block structures with their statistics are kept for the most recently used grid cells, using at most <capacity> bytes.
+		void setBlockCache(
+		    const real_t cellWidth,
+		    const size_t capacity ) {
+			if ( !( cellWidth > 0 ) ) {
+				throw runtime_error( "Cell width of the block cache must be positive!" );
+			}
+			mCacheStep = log( 1 + cellWidth );
+			mCacheCapacity = capacity;
+		}
+
+		bool hasBlockCache() const {
+			return mCacheStep > 0;
+		}
+
+		size_t cacheHits() const {
+			return mCacheHits;
+		}
+
+		size_t cacheMisses() const {
+			return mCacheMisses;
+		}
+
+
+		// Raise all thresholds to the smallest one, up to a relative precision of BLOCK_BUDGET_PRECISION, for which there are at most <maxBlocks> blocks. This bounds the memory of block tables and of the trellis of StateSequence<ForwardBackward>, at the cost of some compression bias in iterations with an otherwise lower threshold. The threshold is found once by bisection, each step of which iterates over the blocks.
+		void setMaxBlocks( const size_t maxBlocks ) {
+			if ( maxBlocks == 0 ) {
+				throw runtime_error( "Block budget must be positive!" );
+			}
+			mMinThreshold = 0;
+			if ( countBlocks( 0 ) <= maxBlocks ) {
+				return;
+			}
+			// find a threshold within the budget by doubling, then bisect geometrically down to the smallest one
+			real_t lower = 0;
+			real_t upper = 1;
+			while ( countBlocks( upper ) > maxBlocks ) {
+				lower = upper;
+				upper *= 2;
+				if ( !isfinite( upper ) ) {
+					throw runtime_error( "No threshold yields at most " + to_string( maxBlocks ) + " blocks!" );
+				}
+			}
+			while ( upper > lower * ( 1 + BLOCK_BUDGET_PRECISION ) && upper > numeric_limits<real_t>::min() ) {
+				const real_t middle = ( lower > 0 ? sqrt( lower * upper ) : upper / 2 );
+				if ( countBlocks( middle ) > maxBlocks ) {
+					lower = middle;
+				} else {
+					upper = middle;
+				}
+			}
+			mMinThreshold = upper;
+		}
+
+		// the lower bound of all thresholds set by setMaxBlocks()
+		real_t minThreshold() const {
+			return mMinThreshold;
+		}
+
+
+		// Freeze the block structure once createBlocks( theta ) has yielded the same blocks for <iterations> consecutive iterations, after which it keeps using the materialized blocks without consulting the block structure or statistics, until unfreeze() is called. 0 disables this. If <tolerance> is positive, block structures count as the same if their number of blocks differs by at most this fraction from the first structure of the stretch, otherwise their boundaries must be identical.
+		void setAutoStatic(
+		    const size_t iterations,
+		    const real_t tolerance = 0 ) {
+			if ( tolerance < 0 ) {
+				throw runtime_error( "Tolerance for static blocks must not be negative!" );
+			}
+			mStableLimit = iterations;
+			mStableTolerance = tolerance;
+			unfreeze();
+		}
+
+		bool frozen() const {
+			return mFrozen;
+		}
+
+		// let createBlocks( theta ) update the blocks again, and restart counting unchanged iterations
+		void unfreeze() {
+			mFrozen = false;
+			mStableIterations = 0;
+			mLastNrBlocks = 0;
+			mLastHash = 0;
+		}
 
+
+		// NOTE explicit thresholds, e.g. for automatic priors, are used as they are and bypass the cache
 		void createBlocks( real_t thresh ) {
-			mBlocks.createBlocks( thresh );
+			unfreeze();
+			mBlocks.createBlocks( max( thresh, mMinThreshold ) );
+			materialize( mTable );
 		}
 
 		template <typename ParamType>
 		void createBlocks( const Theta<ParamType>& theta ) {
+			if ( mFrozen ) {
+				mPos = 0;
+				return;
+			}
 			mBlocks.createBlocks( theta );
+			real_t threshold = mBlocks.threshold();
+			if ( threshold < mMinThreshold ) {
+				threshold = mMinThreshold;
+				mBlocks.createBlocks( threshold );
+			}
+			if ( mCacheStep <= 0 || !( threshold > 0 ) || !isfinite( threshold ) ) {
+				materialize( mTable );
+			} else {
+				long cell = ( long ) floor( log( threshold ) / mCacheStep );
+				if ( exp( cell * mCacheStep ) < mMinThreshold ) {
+					cell++;	// rounding down must not exceed the block budget
+				}
+				mBlocks.createBlocks( exp( cell * mCacheStep ) );
+				lookupBlocks( cell );
+			}
+			trackStability();
 		}
 
 
 		size_t nrBlocks() const {
-			return mBlocks.nrBlocks();
+			return blockTable().nrBlocks();
 		}
 
 		size_t nrDim() const {
@@ -66,15 +323,15 @@ class Emissions<Statistics<S, T>, Blocks<B>> {
 		}
 
 		size_t start() const {
-			return mBlocks.start();
+			return mCurrent->start( mPos - 1 );
 		}
 
 		size_t end() const {
-			return mBlocks.end();
+			return mCurrent->end( mPos - 1 );
 		}
 
 		size_t blockSize() const {
-			return mBlocks.blockSize();
+			return mCurrent->blockSize( mPos - 1 );
 		}
 
 		size_t size() const {
@@ -82,12 +339,12 @@ class Emissions<Statistics<S, T>, Blocks<B>> {
 		}
 
 		void initForward() {
-			mBlocks.initForward();
+			mPos = 0;
 		}
 
 		bool next() {
-			if ( mBlocks.next() ) {
-				mStats.setStats( mBlocks );
+			if ( mPos < blockTable().nrBlocks() ) {
+				mPos++;
 				return true;
 			} else {
 				return false;
@@ -95,8 +352,8 @@ class Emissions<Statistics<S, T>, Blocks<B>> {
 		}
 
 
-		const SufficientStatistics<T>& suffStat( size_t dim ) const {
-			return mStats.suffStat( dim );
+		SufficientStatistics<T> suffStat( size_t dim ) const {
+			return mCurrent->suffStat( mPos - 1, dim );
 		}
 
 
@@ -0,0 +1,60 @@
+#ifndef GENOMEMAP_HPP
+#define GENOMEMAP_HPP
+
+#include "includes.hpp"
+
+
+// Maps data positions to genome coordinates. Data positions are divided into runs, each of which covers consecutive positions of a single refseq, so only the start of each run needs to be stored. Run starts are also used as forced breakpoints, so that blocks never span refseqs or gaps in the input.
+class GenomeMap {
+
+		struct Run {
+			size_t index;	// first data position of the run
+			size_t refseq;	// index into mRefseqs
+			size_t pos;	// genome position of the first data position
+		};
+
+		vector<string> mRefseqs;
+		vector<Run> mRuns;
+
+	public:
+
+		// Start a new run at data position <index>, which maps to <pos> on <refseq>. Runs must be added in increasing order of <index>.
+		void addRun(
+		    const size_t index,
+		    const string& refseq,
+		    const size_t pos ) {
+			if ( mRuns.size() > 0 && index <= mRuns.back().index ) {
+				if ( index < mRuns.back().index ) {
+					throw runtime_error( "Genome runs must be added in increasing order!" );
+				}
+				mRuns.pop_back();	// previous run is empty
+			}
+			if ( mRefseqs.size() == 0 || mRefseqs.back() != refseq ) {
+				mRefseqs.push_back( refseq );
+			}
+			mRuns.push_back( Run{index, mRefseqs.size() - 1, pos} );
+		}
+
+		size_t nrRuns() const {
+			return mRuns.size();
+		}
+
+		// first data position of run <r>
+		size_t runStart( const size_t r ) const {
+			return mRuns[r].index;
+		}
+
+		const string& refseq( const size_t r ) const {
+			return mRefseqs[mRuns[r].refseq];
+		}
+
+		// genome position of data position <i> in run <r>
+		size_t pos(
+		    const size_t r,
+		    const size_t i ) const {
+			return mRuns[r].pos + ( i - mRuns[r].index );
+		}
+};
+
+
+#endif
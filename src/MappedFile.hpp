@@ -0,0 +1,73 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include "includes.hpp"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+
+// Read-only memory map of an entire file. If the file cannot be mapped (e.g. named pipes, which are not opened at all, or the file is empty), isOpen() returns false and the caller is expected to fall back to stream-based input.
+class MappedFile {
+
+		const char* mData;
+		size_t mSize;
+
+	public:
+
+		// delete copy constructor
+		MappedFile( const MappedFile& that ) = delete;
+
+		MappedFile( const string& filename ) :
+			mData( nullptr ),
+			mSize( 0 ) {
+
+			// NOTE only regular files are opened, since opening and closing a named pipe would make its writer fail, and the stream that the caller falls back to could not read it anymore
+			struct stat info;
+			if ( stat( filename.c_str(), &info ) != 0 ) {
+				throw runtime_error( "Cannot read from input file " + filename + "!" );
+			}
+			if ( !S_ISREG( info.st_mode ) || info.st_size <= 0 ) {
+				return;
+			}
+
+			int fd = open( filename.c_str(), O_RDONLY );
+			if ( fd < 0 ) {
+				throw runtime_error( "Cannot read from input file " + filename + "!" );
+			}
+			void* data = mmap( nullptr, info.st_size, PROT_READ, MAP_PRIVATE, fd, 0 );
+			if ( data != MAP_FAILED ) {
+				mData = ( const char* ) data;
+				mSize = info.st_size;
+				madvise( data, mSize, MADV_SEQUENTIAL );
+			}
+			close( fd );
+		}
+
+		~MappedFile() {
+			if ( mData != nullptr ) {
+				munmap( ( void* ) mData, mSize );
+			}
+		}
+
+		bool isOpen() const {
+			return mData != nullptr;
+		}
+
+		const char* begin() const {
+			return mData;
+		}
+
+		const char* end() const {
+			return mData + mSize;
+		}
+
+		size_t size() const {
+			return mSize;
+		}
+};
+
+
+#endif
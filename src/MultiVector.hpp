@@ -7,10 +7,18 @@ using std::vector;
 #include <stdexcept>
 using std::runtime_error;
 
+#include "SufficientStatistics.hpp"
+#include "utils.hpp"
+
+
+const size_t MULTIVECTOR_SWAP_CHUNK_SIZE = 1 << 16;	// number of positions converted before the corresponding memory of the interleaved input is released
+
+
+// Values of type T for a number of positions and dimensions, stored interleaved by position, i.e. entry (pos, dim) is at pos * nrDim + dim.
 template <typename T>
 class MultiVector {
 		vector<T> mVec;
-		const size_t mNrDim;
+		size_t mNrDim;
 
 	public:
 
@@ -65,6 +73,15 @@ class MultiVector {
 			}
 		}
 
+		// unchecked access for hot loops
+		inline const T& get( size_t pos, size_t dim ) const {
+			return mVec[pos * mNrDim + dim];
+		}
+
+		inline void set( size_t pos, size_t dim, const T& entry ) {
+			mVec[pos * mNrDim + dim] = entry;
+		}
+
 		size_t size() const {
 			return mVec.size() / mNrDim;
 		}
@@ -79,6 +96,12 @@ class MultiVector {
 		}
 
 
+		// remove all entries, but keep the allocated memory
+		void clear() {
+			mVec.clear();
+		}
+
+
 		void push_back( T& entry ) {
 			mVec.reserve( mVec.size() + mNrDim );
 			for ( size_t d = 0; d < mNrDim; ++d ) {
@@ -100,4 +123,118 @@ class MultiVector {
 		}
 };
 
+
+
+// Normal sufficient statistics are stored as a structure of arrays, i.e. one contiguous array of sums and one of sums of squares for each dimension, so that the statistics of consecutive positions can be loaded into vector registers without unpacking them. Since entries are not stored as objects, they are returned by value.
+template <>
+class MultiVector<SufficientStatistics<Normal>> {
+		vector<vector<real_t>> mSums;	// mSums[dim][pos]
+		vector<vector<real_t>> mSumSqs;
+		size_t mNrDim;
+		size_t mSize;
+
+	public:
+
+
+		MultiVector(
+		    size_t nrDim
+		):
+			mSums( nrDim ),
+			mSumSqs( nrDim ),
+			mNrDim( nrDim ),
+			mSize( 0 ) {
+			if ( mNrDim <= 0 ) {
+				throw runtime_error( "Number of dimensions in multivector must be positive!" );
+			}
+		}
+
+
+		inline SufficientStatistics<Normal> operator()( size_t pos, size_t dim ) const {
+			if ( dim >= mNrDim ) {
+				throw runtime_error( "Multivector dimension index out of bounds!" );
+			}
+			if ( pos >= mSize ) {
+				throw runtime_error( "Multivector index out of bounds!" );
+			}
+			return get( pos, dim );
+		}
+
+		// unchecked access for hot loops
+		inline SufficientStatistics<Normal> get( size_t pos, size_t dim ) const {
+			return SufficientStatistics<Normal>( mSums[dim][pos], mSumSqs[dim][pos] );
+		}
+
+		inline void set( size_t pos, size_t dim, const SufficientStatistics<Normal>& entry ) {
+			mSums[dim][pos] = entry.sum();
+			mSumSqs[dim][pos] = entry.sumSq();
+		}
+
+		// the contiguous arrays of each component of dimension <dim>, for vectorized loops over positions
+		const real_t* sums( size_t dim ) const {
+			return mSums[dim].data();
+		}
+
+		const real_t* sumSqs( size_t dim ) const {
+			return mSumSqs[dim].data();
+		}
+
+		size_t size() const {
+			return mSize;
+		}
+
+		void reserve( size_t size ) {
+			for ( size_t d = 0; d < mNrDim; ++d ) {
+				mSums[d].reserve( size );
+				mSumSqs[d].reserve( size );
+			}
+		}
+
+
+		void resize( size_t N ) {
+			for ( size_t d = 0; d < mNrDim; ++d ) {
+				mSums[d].resize( N );
+				mSumSqs[d].resize( N );
+			}
+			mSize = N;
+		}
+
+
+		// remove all entries, but keep the allocated memory
+		void clear() {
+			resize( 0 );
+		}
+
+
+		// NOTE unlike the interleaved version, this takes the entries of <vec> in interleaved order and splits them into components, <vec> is empty afterwards
+		void swap( vector<SufficientStatistics<Normal>>& vec ) {
+			const size_t s = vec.size();
+			if ( s != ( s / mNrDim )*mNrDim ) {
+				throw runtime_error( "Cannot swap into multivector, size is not a multiple of dimensions!" );
+			}
+			// NOTE the components are reserved rather than resized, so their memory is only committed while the entries are copied, and the pages of <vec> that have been copied are released right away, so that the conversion does not need twice the memory of the statistics
+			mSize = s / mNrDim;
+			for ( size_t d = 0; d < mNrDim; ++d ) {
+				deleteVector( mSums[d] );
+				deleteVector( mSumSqs[d] );
+				mSums[d].reserve( mSize );
+				mSumSqs[d].reserve( mSize );
+			}
+			for ( size_t start = 0; start < mSize; start += MULTIVECTOR_SWAP_CHUNK_SIZE ) {
+				const size_t end = min( start + MULTIVECTOR_SWAP_CHUNK_SIZE, mSize );
+				for ( size_t pos = start; pos < end; ++pos ) {
+					for ( size_t d = 0; d < mNrDim; ++d ) {
+						mSums[d].push_back( vec[pos * mNrDim + d].sum() );
+						mSumSqs[d].push_back( vec[pos * mNrDim + d].sumSq() );
+					}
+				}
+				releasePages( vec.data() + start * mNrDim, vec.data() + end * mNrDim );
+			}
+			deleteVector( vec );
+		}
+
+		size_t nrDim()const {
+			return mNrDim;
+		}
+};
+
 #endif
@@ -0,0 +1,201 @@
+#ifndef PARALLEL_HPP
+#define PARALLEL_HPP
+
+#include "includes.hpp"
+
+#include <thread>
+using std::thread;
+
+#include <atomic>
+using std::atomic;
+using std::memory_order_acquire;
+using std::memory_order_release;
+using std::memory_order_relaxed;
+using std::memory_order_seq_cst;
+using std::atomic_thread_fence;
+
+#include <mutex>
+using std::mutex;
+using std::lock_guard;
+using std::unique_lock;
+
+#include <condition_variable>
+using std::condition_variable;
+
+#include <exception>
+using std::exception_ptr;
+using std::current_exception;
+using std::rethrow_exception;
+
+using std::this_thread::yield;
+
+
+// Run task(i) for all i in [0, nrTasks) on up to nrThreads threads, including the calling thread. Tasks are handed out one at a time, so they may differ in cost. If a task throws, no further tasks are started, and the exception is rethrown in the calling thread.
+template<typename TaskType>
+void parallelFor(
+    const size_t nrTasks,
+    size_t nrThreads,
+    const TaskType& task ) {
+
+	nrThreads = min( nrThreads, nrTasks );
+	if ( nrThreads <= 1 ) {
+		for ( size_t i = 0; i < nrTasks; ++i ) {
+			task( i );
+		}
+		return;
+	}
+
+	atomic<size_t> nextTask( 0 );
+	exception_ptr error;
+	mutex errorMutex;
+
+	auto worker = [&]() {
+		try {
+			for ( size_t i = nextTask++; i < nrTasks; i = nextTask++ ) {
+				task( i );
+			}
+		} catch ( ... ) {
+			lock_guard<mutex> lock( errorMutex );
+			if ( !error ) {
+				error = current_exception();
+			}
+			nextTask = nrTasks;
+		}
+	};
+
+	vector<thread> threads;
+	threads.reserve( nrThreads - 1 );
+	for ( size_t t = 1; t < nrThreads; ++t ) {
+		threads.push_back( thread( worker ) );
+	}
+	worker();
+	for ( auto & t : threads ) {
+		t.join();
+	}
+
+	if ( error ) {
+		rethrow_exception( error );
+	}
+}
+
+
+
+const size_t SPSC_RING_SPIN_COUNT = 64;	// number of times a thread waiting for the ring buffer yields before it blocks on a condition variable
+const size_t CACHE_LINE_SIZE = 64;	// in bytes, used to pad data written by different threads
+
+
+
+// A bounded lock-free ring buffer for exactly one producer thread and one consumer thread. Slots are preallocated and filled in place: the producer obtains the next free slot with back(), fills it and calls push(); the consumer obtains the oldest filled slot with front(), uses it and calls pop(). Both return nullptr instead of blocking, while waitBack() and waitFront() wait for a slot, first by yielding for a short while, and then by blocking on a condition variable, so that a thread waiting for a slow peer does not keep a core busy. The lock is only taken if the other thread is blocked.
+template<typename T>
+class SpscRing {
+
+		vector<T> mSlots;
+
+		// Total number of slots pushed and popped; only the producer writes mTail and only the consumer writes mHead. The padding keeps each of them on a cache line of its own. NOTE alignas would not do, since operator new ignores over-alignment before C++17, and the ring is allocated on the heap as part of PipelinedReader.
+		char mPadSlots[CACHE_LINE_SIZE];
+		atomic<size_t> mHead;
+		char mPadHead[CACHE_LINE_SIZE - sizeof( atomic<size_t> )];
+		atomic<size_t> mTail;
+		char mPadTail[CACHE_LINE_SIZE - sizeof( atomic<size_t> )];
+
+		// number of threads blocked in wait(), which are woken up by wake()
+		atomic<size_t> mNrWaiting;
+		mutex mMutex;
+		condition_variable mChanged;
+
+
+		// wait until <ready> returns true
+		template<typename ReadyType>
+		void wait( const ReadyType& ready ) {
+			for ( size_t i = 0; i < SPSC_RING_SPIN_COUNT; ++i ) {
+				if ( ready() ) {
+					return;
+				}
+				yield();
+			}
+			unique_lock<mutex> lock( mMutex );
+			mNrWaiting++;
+			atomic_thread_fence( memory_order_seq_cst );	// NOTE pairs with the fence in wake(), so that either the waiting thread sees the change, or the other thread sees that it is waiting
+			mChanged.wait( lock, ready );
+			mNrWaiting--;
+		}
+
+	public:
+
+		// delete copy constructor
+		SpscRing( const SpscRing& that ) = delete;
+
+		SpscRing(
+		    const size_t nrSlots,
+		    const T& slot = T() ) :
+			mSlots( nrSlots, slot ),
+			mHead( 0 ),
+			mTail( 0 ),
+			mNrWaiting( 0 ) {
+			if ( nrSlots == 0 ) {
+				throw runtime_error( "Ring buffer must have at least one slot!" );
+			}
+		}
+
+		// the next free slot, or nullptr if the ring is full (producer only)
+		T* back() {
+			const size_t tail = mTail.load( memory_order_relaxed );
+			if ( tail - mHead.load( memory_order_acquire ) == mSlots.size() ) {
+				return nullptr;
+			}
+			return &mSlots[tail % mSlots.size()];
+		}
+
+		// wait until back() returns a free slot and return it, or return nullptr once <stop> is set and wake() has been called (producer only)
+		T* waitBack( const atomic<bool>& stop ) {
+			T* slot = nullptr;
+			wait( [&]() {
+				slot = back();
+				return slot != nullptr || stop;
+			} );
+			return slot;
+		}
+
+		// hand the slot returned by back() to the consumer (producer only)
+		void push() {
+			mTail.store( mTail.load( memory_order_relaxed ) + 1, memory_order_release );
+			wake();
+		}
+
+		// the oldest filled slot, or nullptr if the ring is empty (consumer only)
+		T* front() {
+			const size_t head = mHead.load( memory_order_relaxed );
+			if ( head == mTail.load( memory_order_acquire ) ) {
+				return nullptr;
+			}
+			return &mSlots[head % mSlots.size()];
+		}
+
+		// wait until front() returns a filled slot and return it (consumer only)
+		T* waitFront() {
+			T* slot = nullptr;
+			wait( [&]() {
+				slot = front();
+				return slot != nullptr;
+			} );
+			return slot;
+		}
+
+		// return the slot returned by front() to the producer (consumer only)
+		void pop() {
+			mHead.store( mHead.load( memory_order_relaxed ) + 1, memory_order_release );
+			wake();
+		}
+
+		// wake up a thread blocked in waitBack() or waitFront(), which is done by push() and pop(), and has to be done explicitly after other changes that a waiting thread should see, e.g. setting the stop flag
+		void wake() {
+			atomic_thread_fence( memory_order_seq_cst );
+			if ( mNrWaiting.load( memory_order_relaxed ) > 0 ) {
+				lock_guard<mutex> lock( mMutex );
+				mChanged.notify_all();
+			}
+		}
+};
+
+
+#endif
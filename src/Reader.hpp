@@ -0,0 +1,118 @@
+#ifndef READER_HPP
+#define READER_HPP
+
+#include "includes.hpp"
+
+
+// A source of numeric input values, in the order expected by MaxletTransform (dimensions first, then positions). Values are delivered in blocks, so the cost of the virtual call is amortized over many values, and the concrete input format can be chosen at run-time.
+class Reader {
+
+	public:
+
+		virtual ~Reader() {}
+
+		// Write up to <maxNrValues> values to <values> and return the number of values written. Returning 0 signals the end of the input. Invalid input throws an exception.
+		virtual size_t read(
+		    real_t* values,
+		    const size_t maxNrValues ) = 0;
+
+		// An estimate of the total number of values (i.e. the number of positions times the number of dimensions, not the number of lines), used to reserve memory. Returns 0 if unknown.
+		virtual size_t sizeHint() const {
+			return 0;
+		}
+
+		// The number of dimensions per position if the input format specifies it, 0 otherwise.
+		virtual size_t nrDim() const {
+			return 0;
+		}
+};
+
+
+#include "Reader/StreamReader.hpp"
+#include "Reader/MappedTextReader.hpp"
+#include "Reader/BinaryReader.hpp"
+#include "Reader/GzipReader.hpp"
+#include "Reader/PipelinedReader.hpp"
+#include "Reader/InterleavedReader.hpp"
+#include "Reader/ColumnReader.hpp"
+#include "Reader/CountsReader.hpp"
+#include "Reader/RunLengthReader.hpp"
+
+
+// Create a reader for a memory-mapped file. <format> are the tokens passed to -F: "auto" detects .npy and HaMMLET binary headers and treats everything else as text, "text", "npy" and "binary" force the respective format, and "raw f4" or "raw f8" read headerless float32 or float64 arrays with <nrDim> dimensions. Gzip-compressed text (including BGZF) is detected for "auto" and "text", and BGZF blocks are decompressed on <nrThreads> threads.
+// "tsv", "csv" and "bed" select value columns from delimited text, followed by the columns to use, and optionally the keyword "coords" and the columns to copy to <coordinates>. For bed, the value column defaults to 4 and the coordinate columns to 1 2 3.
+unique_ptr<Reader> createReader(
+    const MappedFile& file,
+    const vector<string>& format,
+    const size_t nrDim,
+    const size_t nrThreads = 1,
+    ostream* coordinates = nullptr ) {
+
+	const string type = ( format.size() > 0 ? format[0] : "auto" );
+	if ( type == "tsv" || type == "csv" || type == "bed" ) {
+		if ( isGzip( file ) ) {
+			throw runtime_error( "Column selection is not supported for compressed input!" );
+		}
+		vector<string> valueColumns;
+		vector<string> coordColumns;
+		size_t i = 1;
+		for ( ; i < format.size() && format[i] != "coords"; ++i ) {
+			valueColumns.push_back( format[i] );
+		}
+		for ( ++i; i < format.size(); ++i ) {
+			coordColumns.push_back( format[i] );
+		}
+		if ( type == "bed" ) {
+			if ( valueColumns.size() == 0 ) {
+				valueColumns = {"4"};
+			}
+			if ( coordColumns.size() == 0 ) {
+				coordColumns = {"1", "2", "3"};
+			}
+		}
+		if ( coordinates != nullptr && coordColumns.size() == 0 ) {
+			throw runtime_error( "Output of coordinates requires coordinate columns, use -F " + type + " ... coords COLUMN ...!" );
+		}
+		return unique_ptr<Reader>( new ColumnReader( file, ( type == "csv" ? ',' : '\t' ), valueColumns, coordColumns, coordinates ) );
+	} else if ( ( type == "auto" || type == "text" ) && isGzip( file ) ) {
+		return unique_ptr<Reader>( new GzipReader( file, nrThreads ) );
+	} else if ( type == "auto" ) {
+		if ( hasMagic( file, NPY_MAGIC, NPY_MAGIC_SIZE ) || hasMagic( file, HAMMLET_BINARY_MAGIC, HAMMLET_BINARY_MAGIC_SIZE ) ) {
+			return unique_ptr<Reader>( new BinaryReader( file ) );
+		} else {
+			return unique_ptr<Reader>( new MappedTextReader( file ) );
+		}
+	} else if ( type == "text" ) {
+		return unique_ptr<Reader>( new MappedTextReader( file ) );
+	} else if ( type == "npy" || type == "binary" ) {
+		return unique_ptr<Reader>( new BinaryReader( file ) );
+	} else if ( type == "raw" ) {
+		if ( format.size() < 2 ) {
+			throw runtime_error( "Input format raw requires a data type, f4 or f8!" );
+		}
+		if ( format[1] == "f4" ) {
+			return unique_ptr<Reader>( new BinaryReader( file, 4, nrDim ) );
+		} else if ( format[1] == "f8" ) {
+			return unique_ptr<Reader>( new BinaryReader( file, 8, nrDim ) );
+		} else {
+			throw runtime_error( "Unknown raw data type " + format[1] + ", use f4 or f8!" );
+		}
+	} else {
+		throw runtime_error( "Unknown input format " + type + "!" );
+	}
+}
+
+
+
+// If more than one thread is available, run <reader> on a separate producer thread, so that parsing overlaps with the maxlet transform.
+unique_ptr<Reader> pipelineReader(
+    unique_ptr<Reader> reader,
+    const size_t nrThreads ) {
+	if ( nrThreads > 1 ) {
+		return unique_ptr<Reader>( new PipelinedReader( std::move( reader ) ) );
+	}
+	return reader;
+}
+
+
+#endif
@@ -0,0 +1,250 @@
+#ifndef BINARYREADER_HPP
+#define BINARYREADER_HPP
+
+#include "../Reader.hpp"
+#include "../MappedFile.hpp"
+#include "../Parser.hpp"
+#include "../uintmath.hpp"
+
+#include <cstring>
+using std::memcmp;
+using std::memcpy;
+
+using std::getline;
+
+
+// Magic bytes of NumPy's .npy format and of HaMMLET's own binary format. The latter is followed by a little-endian header of uint64 number of positions, uint32 number of dimensions, and uint32 bytes per value (4 for float32, 8 for float64), after which the values follow in position-major order.
+const char NPY_MAGIC[] = "\x93NUMPY";
+const size_t NPY_MAGIC_SIZE = 6;
+const char HAMMLET_BINARY_MAGIC[] = "HMLTBIN1";
+const size_t HAMMLET_BINARY_MAGIC_SIZE = 8;
+const size_t HAMMLET_BINARY_HEADER_SIZE = HAMMLET_BINARY_MAGIC_SIZE + 8 + 4 + 4;
+
+
+// read a little-endian unsigned integer of <nrBytes> bytes
+inline uint64_t readLittleEndian(
+    const char* data,
+    const size_t nrBytes ) {
+	uint64_t result = 0;
+	for ( size_t i = nrBytes; i > 0; --i ) {
+		result = ( result << 8 ) | ( unsigned char ) data[i - 1];
+	}
+	return result;
+}
+
+
+// check whether a mapped file starts with the given magic bytes
+inline bool hasMagic(
+    const MappedFile& file,
+    const char* magic,
+    const size_t magicSize ) {
+	return file.size() >= magicSize && memcmp( file.begin(), magic, magicSize ) == 0;
+}
+
+
+
+// Reads binary arrays of float32 or float64 values, either raw or from a file with a .npy or HaMMLET header. Since the number of positions and dimensions is known from the header (or the file size for raw input), the output arrays can be sized exactly.
+class BinaryReader : public Reader {
+
+		const MappedFile& mFile;
+		const char* mData;	// start of the values
+		size_t mBytesPerValue;
+		size_t mNrPositions;
+		size_t mNrDim;
+		bool mColumnMajor;	// Fortran order, i.e. all positions of the first dimension come first
+		size_t mIndex;	// index of the next value in position-major order
+
+
+		// extract the value of a key from the Python dictionary literal in a .npy header
+		static string npyHeaderValue(
+		    const string& header,
+		    const string& key ) {
+			size_t pos = header.find( "'" + key + "'" );
+			if ( pos == string::npos ) {
+				throw runtime_error( "Missing key " + key + " in .npy header!" );
+			}
+			pos = header.find( ":", pos );
+			if ( pos == string::npos ) {
+				throw runtime_error( "Invalid .npy header!" );
+			}
+			pos = header.find_first_not_of( " ", pos + 1 );
+			size_t end;
+			if ( header[pos] == '(' ) {
+				end = header.find( ")", pos ) + 1;
+			} else if ( header[pos] == '\'' ) {
+				end = header.find( "'", pos + 1 ) + 1;
+			} else {
+				end = header.find_first_of( ",}", pos );
+			}
+			return header.substr( pos, end - pos );
+		}
+
+
+		void parseNpyHeader() {
+			if ( mFile.size() < 10 ) {
+				throw runtime_error( "Truncated .npy header!" );
+			}
+			const char* data = mFile.begin();
+			const unsigned char majorVersion = data[NPY_MAGIC_SIZE];
+			size_t headerStart;
+			size_t headerSize;
+			if ( majorVersion == 1 ) {
+				headerSize = readLittleEndian( data + 8, 2 );
+				headerStart = 10;
+			} else {
+				if ( mFile.size() < 12 ) {
+					throw runtime_error( "Truncated .npy header!" );
+				}
+				headerSize = readLittleEndian( data + 8, 4 );
+				headerStart = 12;
+			}
+			if ( headerStart + headerSize > mFile.size() ) {
+				throw runtime_error( "Truncated .npy header!" );
+			}
+			const string header( data + headerStart, headerSize );
+			mData = data + headerStart + headerSize;
+
+			const string descr = npyHeaderValue( header, "descr" );
+			if ( descr == "'<f4'" || descr == "'f4'" ) {
+				mBytesPerValue = 4;
+			} else if ( descr == "'<f8'" || descr == "'f8'" ) {
+				mBytesPerValue = 8;
+			} else {
+				throw runtime_error( "Unsupported .npy data type " + descr + ", only little-endian float32 and float64 are supported!" );
+			}
+
+			mColumnMajor = ( npyHeaderValue( header, "fortran_order" ) == "True" );
+
+			// shape is a tuple of one or two integers
+			string shape = npyHeaderValue( header, "shape" );
+			vector<size_t> extents;
+			istringstream ss( shape.substr( 1, shape.size() - 2 ) );
+			string token;
+			while ( getline( ss, token, ',' ) ) {
+				if ( token.find_first_not_of( " " ) != string::npos ) {
+					extents.push_back( convertType<size_t>( token ) );
+				}
+			}
+			if ( extents.size() == 1 ) {
+				mNrPositions = extents[0];
+				mNrDim = 1;
+			} else if ( extents.size() == 2 ) {
+				mNrPositions = extents[0];
+				mNrDim = extents[1];
+			} else {
+				throw runtime_error( "Unsupported .npy shape " + shape + ", arrays must have one or two dimensions!" );
+			}
+		}
+
+
+		void parseHammletHeader() {
+			if ( mFile.size() < HAMMLET_BINARY_HEADER_SIZE ) {
+				throw runtime_error( "Truncated binary header!" );
+			}
+			const char* data = mFile.begin() + HAMMLET_BINARY_MAGIC_SIZE;
+			mNrPositions = readLittleEndian( data, 8 );
+			mNrDim = readLittleEndian( data + 8, 4 );
+			mBytesPerValue = readLittleEndian( data + 12, 4 );
+			mData = mFile.begin() + HAMMLET_BINARY_HEADER_SIZE;
+			if ( mBytesPerValue != 4 && mBytesPerValue != 8 ) {
+				throw runtime_error( "Unsupported value size in binary header, must be 4 (float32) or 8 (float64)!" );
+			}
+		}
+
+
+		// read value i of the stored array, in storage order
+		inline real_t value( size_t i ) const {
+			if ( mBytesPerValue == 4 ) {
+				float v;
+				memcpy( &v, mData + 4 * i, 4 );
+				return v;
+			} else {
+				double v;
+				memcpy( &v, mData + 8 * i, 8 );
+				return v;
+			}
+		}
+
+	public:
+
+		// Read a file with a .npy or HaMMLET binary header.
+		BinaryReader(
+		    const MappedFile& file ) :
+			mFile( file ),
+			mColumnMajor( false ),
+			mIndex( 0 ) {
+
+			if ( hasMagic( mFile, NPY_MAGIC, NPY_MAGIC_SIZE ) ) {
+				parseNpyHeader();
+			} else if ( hasMagic( mFile, HAMMLET_BINARY_MAGIC, HAMMLET_BINARY_MAGIC_SIZE ) ) {
+				parseHammletHeader();
+			} else {
+				throw runtime_error( "Binary input file has neither a .npy nor a HaMMLET header!" );
+			}
+			if ( mNrDim == 0 ) {
+				throw runtime_error( "Binary input has zero dimensions!" );
+			}
+			if ( ( size_t )( mFile.end() - mData ) < mNrPositions * mNrDim * mBytesPerValue ) {
+				throw runtime_error( "Binary input file is shorter than specified in its header!" );
+			}
+		}
+
+
+		// Read a raw file without header, containing <bytesPerValue>-byte floats for <nrDim> dimensions in position-major order.
+		BinaryReader(
+		    const MappedFile& file,
+		    const size_t bytesPerValue,
+		    const size_t nrDim ) :
+			mFile( file ),
+			mData( file.begin() ),
+			mBytesPerValue( bytesPerValue ),
+			mNrPositions( 0 ),
+			mNrDim( nrDim ),
+			mColumnMajor( false ),
+			mIndex( 0 ) {
+
+			if ( mBytesPerValue != 4 && mBytesPerValue != 8 ) {
+				throw runtime_error( "Raw binary input must consist of 4-byte (f4) or 8-byte (f8) floats!" );
+			}
+			if ( mNrDim == 0 ) {
+				throw runtime_error( "Number of dimensions must be positive!" );
+			}
+			if ( !divides( mFile.size(), mBytesPerValue * mNrDim ) ) {
+				throw runtime_error( "Size of raw binary input (" + to_string( mFile.size() ) + " bytes) is not a multiple of " + to_string( mBytesPerValue * mNrDim ) + " bytes per position!" );
+			}
+			mNrPositions = mFile.size() / ( mBytesPerValue * mNrDim );
+		}
+
+
+		size_t read(
+		    real_t* values,
+		    const size_t maxNrValues ) {
+			const size_t total = mNrPositions * mNrDim;
+			const size_t n = min( maxNrValues, total - mIndex );
+			if ( mColumnMajor ) {
+				for ( size_t k = 0; k < n; ++k ) {
+					const size_t i = mIndex + k;
+					values[k] = value( ( i % mNrDim ) * mNrPositions + i / mNrDim );
+				}
+			} else if ( mBytesPerValue == sizeof( real_t ) ) {
+				memcpy( values, mData + mIndex * sizeof( real_t ), n * sizeof( real_t ) );
+			} else {
+				for ( size_t k = 0; k < n; ++k ) {
+					values[k] = value( mIndex + k );
+				}
+			}
+			mIndex += n;
+			return n;
+		}
+
+		size_t sizeHint() const {
+			return mNrPositions * mNrDim;
+		}
+
+		size_t nrDim() const {
+			return mNrDim;
+		}
+};
+
+
+#endif
@@ -0,0 +1,244 @@
+#ifndef COLUMNREADER_HPP
+#define COLUMNREADER_HPP
+
+#include "../Reader.hpp"
+#include "../MappedFile.hpp"
+#include "MappedTextReader.hpp"
+
+#include <cstring>
+using std::memchr;
+using std::strncmp;
+
+#include <utility>
+using std::pair;
+
+using std::ostream;
+
+
+// Reads selected columns from a delimited text file such as TSV, CSV or BED, one position per line. Each selected value column is one data dimension. Empty lines and comment lines (starting with #, or with track or browser as in BED files) are skipped. Columns are selected by 1-based index or by name, in which case the first non-comment line is used as a header. Otherwise, the first line is only treated as a header if its selected fields are not numeric.
+// Optionally, coordinate columns (e.g. chromosome, start and end) are copied to a separate stream, one line per position, so that results can be mapped back to the input.
+class ColumnReader : public Reader {
+
+		typedef pair<const char*, const char*> Field;
+
+		const MappedFile& mFile;
+		const char mDelimiter;
+		vector<size_t> mValueColumns;	// 0-based
+		vector<size_t> mCoordColumns;
+		size_t mNrColumns;	// number of columns that need to be split
+		ostream* mCoordinates;
+
+		const char* mPos;
+		size_t mLineNr;
+		size_t mSizeHint;
+		vector<Field> mFields;
+
+
+		// return the end of the line starting at <pos>
+		const char* lineEnd( const char* pos ) const {
+			const char* end = ( const char* ) memchr( pos, '\n', mFile.end() - pos );
+			return ( end == nullptr ? mFile.end() : end );
+		}
+
+
+		// return the start of the line after the one starting at <pos>
+		const char* nextLine( const char* pos ) const {
+			const char* end = lineEnd( pos );
+			return ( end < mFile.end() ? end + 1 : end );
+		}
+
+
+		static bool isComment(
+		    const char* begin,
+		    const char* end ) {
+			while ( begin < end && isSpace( *begin ) ) {
+				begin++;
+			}
+			const size_t length = end - begin;
+			return length == 0 || *begin == '#' || ( length >= 5 && strncmp( begin, "track", 5 ) == 0 ) || ( length >= 7 && strncmp( begin, "browser", 7 ) == 0 );
+		}
+
+
+		// split [begin, end) into at most <maxNrFields> fields, and return the number of fields found
+		size_t split(
+		    const char* begin,
+		    const char* end,
+		    vector<Field>& fields,
+		    const size_t maxNrFields ) const {
+			if ( end > begin && end[-1] == '\r' ) {
+				end--;
+			}
+			size_t n = 0;
+			for ( ; n < maxNrFields; ++n ) {
+				const char* fieldEnd = ( const char* ) memchr( begin, mDelimiter, end - begin );
+				if ( fieldEnd == nullptr ) {
+					fieldEnd = end;
+				}
+				if ( n >= fields.size() ) {
+					fields.resize( n + 1 );
+				}
+				fields[n] = Field( begin, fieldEnd );
+				if ( fieldEnd == end ) {
+					return n + 1;
+				}
+				begin = fieldEnd + 1;
+			}
+			return n;
+		}
+
+
+		// parse a field that must consist of a single number, possibly surrounded by whitespace
+		static bool parseField(
+		    const Field& field,
+		    real_t& value ) {
+			const char* begin = field.first;
+			const char* end = field.second;
+			while ( begin < end && isSpace( *begin ) ) {
+				begin++;
+			}
+			while ( end > begin && isSpace( end[-1] ) ) {
+				end--;
+			}
+			return begin < end && scanReal( begin, end, value ) == end;
+		}
+
+
+		// resolve column specifications (1-based index or name) to 0-based indices
+		static vector<size_t> resolveColumns(
+		    const vector<string>& specs,
+		    const vector<string>& header ) {
+			vector<size_t> columns;
+			for ( const auto & spec : specs ) {
+				if ( spec.find_first_not_of( "0123456789" ) == string::npos ) {
+					const size_t column = convertType<size_t>( spec );
+					if ( column == 0 ) {
+						throw runtime_error( "Column indices start at 1!" );
+					}
+					columns.push_back( column - 1 );
+				} else {
+					const auto it = find( header.begin(), header.end(), spec );
+					if ( it == header.end() ) {
+						throw runtime_error( "Column " + spec + " not found in header!" );
+					}
+					columns.push_back( it - header.begin() );
+				}
+			}
+			return columns;
+		}
+
+	public:
+
+		ColumnReader(
+		    const MappedFile& file,
+		    const char delimiter,
+		    const vector<string>& valueColumns,
+		    const vector<string>& coordColumns = vector<string>(),
+		    ostream* coordinates = nullptr ) :
+			mFile( file ),
+			mDelimiter( delimiter ),
+			mNrColumns( 0 ),
+			mCoordinates( coordinates ),
+			mPos( file.begin() ),
+			mLineNr( 0 ),
+			mSizeHint( 0 ) {
+
+			if ( valueColumns.size() == 0 ) {
+				throw runtime_error( "No value columns selected!" );
+			}
+
+			// skip comments up to the first line, which may be a header
+			const char* first = mPos;
+			while ( first < mFile.end() && isComment( first, lineEnd( first ) ) ) {
+				first = nextLine( first );
+				mLineNr++;
+			}
+			mPos = first;
+
+			bool hasNames = false;
+			for ( const auto & spec : valueColumns ) {
+				hasNames |= ( spec.find_first_not_of( "0123456789" ) != string::npos );
+			}
+			for ( const auto & spec : coordColumns ) {
+				hasNames |= ( spec.find_first_not_of( "0123456789" ) != string::npos );
+			}
+
+			vector<string> header;
+			if ( first < mFile.end() ) {
+				const size_t nrFields = split( first, lineEnd( first ), mFields, numeric_limits<size_t>::max() );
+				for ( size_t i = 0; i < nrFields; ++i ) {
+					header.push_back( string( mFields[i].first, mFields[i].second ) );
+				}
+			} else if ( hasNames ) {
+				throw runtime_error( "Cannot select columns by name, input has no header!" );
+			}
+
+			mValueColumns = resolveColumns( valueColumns, header );
+			mCoordColumns = resolveColumns( coordColumns, header );
+			for ( auto c : mValueColumns ) {
+				mNrColumns = max( mNrColumns, c + 1 );
+			}
+			for ( auto c : mCoordColumns ) {
+				mNrColumns = max( mNrColumns, c + 1 );
+			}
+
+			// the first line is a header if columns are selected by name, or if it does not contain numbers in the value columns
+			bool isHeader = hasNames;
+			real_t value;
+			for ( auto c : mValueColumns ) {
+				isHeader |= ( c >= header.size() || !parseField( mFields[c], value ) );
+			}
+			if ( first < mFile.end() && isHeader ) {
+				mPos = nextLine( first );
+				mLineNr++;
+			}
+
+			// count lines as an estimate for the number of positions
+			if ( mPos < mFile.end() ) {
+				mSizeHint = ( countLines( mPos, mFile.end() ) + 1 ) * mValueColumns.size();
+			}
+		}
+
+		size_t read(
+		    real_t* values,
+		    const size_t maxNrValues ) {
+			const size_t nrDim = mValueColumns.size();
+			size_t n = 0;
+			while ( n + nrDim <= maxNrValues && mPos < mFile.end() ) {
+				const char* end = lineEnd( mPos );
+				mLineNr++;
+				if ( !isComment( mPos, end ) ) {
+					if ( split( mPos, end, mFields, mNrColumns ) < mNrColumns ) {
+						throw runtime_error( "Line " + to_string( mLineNr ) + " has fewer than " + to_string( mNrColumns ) + " columns!" );
+					}
+					for ( auto c : mValueColumns ) {
+						if ( !parseField( mFields[c], values[n++] ) ) {
+							throw runtime_error( "Invalid input encountered in line " + to_string( mLineNr ) + ", column " + to_string( c + 1 ) + ": \"" + string( mFields[c].first, mFields[c].second ) + "\"!" );
+						}
+					}
+					if ( mCoordinates != nullptr ) {
+						for ( size_t i = 0; i < mCoordColumns.size(); ++i ) {
+							if ( i > 0 ) {
+								*mCoordinates << '\t';
+							}
+							const Field& field = mFields[mCoordColumns[i]];
+							mCoordinates->write( field.first, field.second - field.first );
+						}
+						*mCoordinates << '\n';
+					}
+				}
+				mPos = ( end < mFile.end() ? end + 1 : end );
+			}
+			return n;
+		}
+
+		size_t sizeHint() const {
+			return mSizeHint;
+		}
+
+		size_t nrDim() const {
+			return mValueColumns.size();
+		}
+};
+
+
+#endif
@@ -0,0 +1,104 @@
+#ifndef COUNTSREADER_HPP
+#define COUNTSREADER_HPP
+
+#include "../Reader.hpp"
+#include "../GenomeMap.hpp"
+#include "../tools/GenomeGetter.hpp"
+
+#include "gzstream.h"
+
+
+// Reads the count files written by samToCounts and combineCounts, i.e. PREFIX-size.csv, PREFIX-pos.csv.gz and PREFIX-count.csv.gz, which only contain positions with non-zero counts. Gaps between positions of the same refseq are either filled with zeros, which are generated on the fly, or skipped; in the latter case, each gap starts a new run in the genome map, which forces a breakpoint. A new refseq always starts a new run.
+class CountsReader : public Reader {
+
+		GenomeGetter mGenome;
+		igzstream mCountFile;
+		const bool mFillGaps;
+		GenomeMap* mGenomeMap;
+
+		size_t mIndex;	// number of values produced so far
+		size_t mNrZeros;	// number of zeros to produce before mCount
+		real_t mCount;
+		bool mHasCount;	// whether mCount still needs to be produced
+
+
+		// read the next position and count, and determine the gap before it; returns false at the end of the input
+		bool next() {
+			if ( !mGenome.next() ) {
+				string line;
+				if ( mCountFile >> line ) {
+					throw runtime_error( "Count file has more entries than position file!" );
+				}
+				return false;
+			}
+			if ( !( mCountFile >> mCount ) ) {
+				throw runtime_error( "Count file has fewer entries than position file!" );
+			}
+			mHasCount = true;
+
+			if ( mGenome.refseqChanged() ) {
+				if ( mGenomeMap != nullptr ) {
+					mGenomeMap->addRun( mIndex, mGenome.refseq(), mGenome.pos() );
+				}
+			} else if ( mGenome.pos() <= mGenome.prevPos() ) {
+				throw runtime_error( "Positions on " + mGenome.refseq() + " must be increasing, found " + to_string( mGenome.pos() ) + " after " + to_string( mGenome.prevPos() ) + "!" );
+			} else if ( mGenome.pos() > mGenome.prevPos() + 1 ) {
+				if ( mFillGaps ) {
+					mNrZeros = mGenome.pos() - mGenome.prevPos() - 1;
+				} else if ( mGenomeMap != nullptr ) {
+					mGenomeMap->addRun( mIndex, mGenome.refseq(), mGenome.pos() );
+				}
+			}
+			return true;
+		}
+
+	public:
+
+		// delete copy constructor
+		CountsReader( const CountsReader& that ) = delete;
+
+		CountsReader(
+		    const string& prefix,
+		    const bool fillGaps,
+		    GenomeMap* genomeMap = nullptr ) :
+			mGenome( prefix ),
+			mFillGaps( fillGaps ),
+			mGenomeMap( genomeMap ),
+			mIndex( 0 ),
+			mNrZeros( 0 ),
+			mCount( 0 ),
+			mHasCount( false ) {
+			mCountFile.open( ( prefix + "-count.csv.gz" ).c_str() );
+			if ( !mCountFile ) {
+				throw runtime_error( "Cannot read " + prefix + "-count.csv.gz!" );
+			}
+		}
+
+		size_t read(
+		    real_t* values,
+		    const size_t maxNrValues ) {
+			size_t n = 0;
+			while ( n < maxNrValues ) {
+				if ( !mHasCount && !next() ) {
+					break;
+				}
+				for ( ; mNrZeros > 0 && n < maxNrValues; --mNrZeros ) {
+					values[n++] = 0;
+					mIndex++;
+				}
+				if ( mNrZeros == 0 && n < maxNrValues ) {
+					values[n++] = mCount;
+					mIndex++;
+					mHasCount = false;
+				}
+			}
+			return n;
+		}
+
+		size_t nrDim() const {
+			return 1;
+		}
+};
+
+
+#endif
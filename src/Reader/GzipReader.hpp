@@ -0,0 +1,382 @@
+#ifndef GZIPREADER_HPP
+#define GZIPREADER_HPP
+
+#include "../Reader.hpp"
+#include "../MappedFile.hpp"
+#include "../Parallel.hpp"
+#include "MappedTextReader.hpp"
+#include "BinaryReader.hpp"
+
+#include <zlib.h>
+
+
+const size_t GZIP_CHUNK_SIZE = 1 << 22;	// size of decompressed chunks for plain gzip input
+const size_t BGZF_BLOCKS_PER_THREAD = 16;	// number of BGZF blocks (at most 64 kB each) decompressed per thread and batch
+
+
+inline bool isGzip( const MappedFile& file ) {
+	return file.size() >= 2 && ( unsigned char ) file.begin()[0] == 0x1f && ( unsigned char ) file.begin()[1] == 0x8b;
+}
+
+
+// If a BGZF block starts at <data>, return its total compressed size, otherwise return 0. BGZF blocks are gzip members whose extra field contains a BC subfield holding the block size.
+inline size_t bgzfBlockSize(
+    const char* data,
+    const size_t available ) {
+	if ( available < 18 || ( unsigned char ) data[0] != 0x1f || ( unsigned char ) data[1] != 0x8b || data[2] != 8 || ( data[3] & 4 ) == 0 ) {
+		return 0;
+	}
+	const size_t extraSize = readLittleEndian( data + 10, 2 );
+	if ( 12 + extraSize > available ) {
+		return 0;
+	}
+	for ( size_t i = 12; i + 4 <= 12 + extraSize; ) {
+		const size_t fieldSize = readLittleEndian( data + i + 2, 2 );
+		if ( data[i] == 'B' && data[i + 1] == 'C' && fieldSize == 2 ) {
+			return readLittleEndian( data + i + 4, 2 ) + 1;
+		}
+		i += 4 + fieldSize;
+	}
+	return 0;
+}
+
+
+
+// Decompresses a memory-mapped gzip file chunk by chunk. BGZF files (as produced by bgzip) consist of independent blocks, which are decompressed in batches on multiple threads; plain gzip is decompressed as a single stream, which may consist of multiple members. In both cases, the next chunk is decompressed in the background while the current one is being used.
+class GzipDecompressor {
+
+		const MappedFile& mFile;
+		const size_t mNrThreads;
+
+		// BGZF: offsets of the compressed blocks (with the end of the last block appended), their uncompressed sizes, and the next block to decompress
+		bool mIsBgzf;
+		vector<size_t> mBlockOffsets;
+		vector<size_t> mBlockSizes;
+		size_t mNextBlock;
+
+		// plain gzip: zlib stream state, and the offset of the next compressed byte to feed into it
+		z_stream mStream;
+		bool mStreamOpen;
+		size_t mInputOffset;
+		bool mInputDone;
+
+		// the next chunk, which is prepared by a background thread
+		vector<char> mNextChunk;
+		bool mHasNextChunk;
+		thread mPrefetch;
+		exception_ptr mPrefetchError;
+
+		size_t mTotalSize;
+
+		void decompressBgzfBlock(
+		    const size_t block,
+		    char* out ) const {
+			const char* data = mFile.begin() + mBlockOffsets[block];
+			const size_t compressedSize = mBlockOffsets[block + 1] - mBlockOffsets[block];
+			const size_t headerSize = 12 + readLittleEndian( data + 10, 2 );
+			const size_t size = mBlockSizes[block];
+
+			z_stream stream;
+			stream.zalloc = Z_NULL;
+			stream.zfree = Z_NULL;
+			stream.opaque = Z_NULL;
+			if ( inflateInit2( &stream, -15 ) != Z_OK ) {
+				throw runtime_error( "Cannot initialize zlib!" );
+			}
+			stream.next_in = ( Bytef* )( data + headerSize );
+			stream.avail_in = compressedSize - headerSize - 8;
+			stream.next_out = ( Bytef* ) out;
+			stream.avail_out = size;
+			const int status = inflate( &stream, Z_FINISH );
+			const size_t produced = stream.total_out;
+			inflateEnd( &stream );
+			if ( ( status != Z_STREAM_END && !( status == Z_BUF_ERROR && size == 0 ) ) || produced != size ) {
+				throw runtime_error( "Corrupt BGZF block at byte " + to_string( mBlockOffsets[block] ) + "!" );
+			}
+			if ( crc32( crc32( 0, Z_NULL, 0 ), ( const Bytef* ) out, size ) != readLittleEndian( data + compressedSize - 8, 4 ) ) {
+				throw runtime_error( "CRC mismatch in BGZF block at byte " + to_string( mBlockOffsets[block] ) + "!" );
+			}
+		}
+
+
+		// decompress the next batch of BGZF blocks on multiple threads
+		bool decompressBgzf( vector<char>& out ) {
+			const size_t nrBlocks = mBlockSizes.size();
+			const size_t first = mNextBlock;
+			const size_t last = min( nrBlocks, first + BGZF_BLOCKS_PER_THREAD * mNrThreads );
+			mNextBlock = last;
+
+			vector<size_t> offsets( 1, 0 );
+			for ( size_t b = first; b < last; ++b ) {
+				offsets.push_back( offsets.back() + mBlockSizes[b] );
+			}
+			out.resize( offsets.back() );
+			parallelFor( last - first, mNrThreads, [&]( size_t i ) {
+				decompressBgzfBlock( first + i, out.data() + offsets[i] );
+			} );
+			return first < last;
+		}
+
+
+		// decompress the next chunk of a plain gzip stream, which may consist of multiple members
+		bool decompressGzip( vector<char>& out ) {
+			out.resize( GZIP_CHUNK_SIZE );
+			size_t produced = 0;
+			while ( produced < out.size() && !mInputDone ) {
+				if ( mStream.avail_in == 0 ) {
+					const size_t remaining = mFile.size() - mInputOffset;
+					if ( remaining == 0 ) {
+						throw runtime_error( "Unexpected end of gzip input!" );
+					}
+					const size_t n = min( remaining, ( size_t ) 1 << 30 );
+					mStream.next_in = ( Bytef* )( mFile.begin() + mInputOffset );
+					mStream.avail_in = n;
+					mInputOffset += n;
+				}
+				mStream.next_out = ( Bytef* )( out.data() + produced );
+				mStream.avail_out = out.size() - produced;
+				const int status = inflate( &mStream, Z_NO_FLUSH );
+				produced = out.size() - mStream.avail_out;
+				if ( status == Z_STREAM_END ) {
+					// continue if another gzip member follows
+					const size_t consumed = mInputOffset - mStream.avail_in;
+					if ( consumed + 2 <= mFile.size() && ( unsigned char ) mFile.begin()[consumed] == 0x1f && ( unsigned char ) mFile.begin()[consumed + 1] == 0x8b ) {
+						inflateReset( &mStream );
+					} else {
+						mInputDone = true;
+					}
+				} else if ( status != Z_OK && status != Z_BUF_ERROR ) {
+					throw runtime_error( "Corrupt gzip input (zlib error " + to_string( status ) + ")!" );
+				}
+			}
+			out.resize( produced );
+			return produced > 0;
+		}
+
+
+		bool decompress( vector<char>& out ) {
+			return ( mIsBgzf ? decompressBgzf( out ) : decompressGzip( out ) );
+		}
+
+
+		void waitForPrefetch() {
+			if ( mPrefetch.joinable() ) {
+				mPrefetch.join();
+			}
+			if ( mPrefetchError ) {
+				rethrow_exception( mPrefetchError );
+			}
+		}
+
+
+	public:
+
+		// delete copy constructor
+		GzipDecompressor( const GzipDecompressor& that ) = delete;
+
+		GzipDecompressor(
+		    const MappedFile& file,
+		    const size_t nrThreads = 1 ) :
+			mFile( file ),
+			mNrThreads( max( nrThreads, ( size_t ) 1 ) ),
+			mIsBgzf( false ),
+			mNextBlock( 0 ),
+			mStreamOpen( false ),
+			mInputOffset( 0 ),
+			mInputDone( false ),
+			mHasNextChunk( false ),
+			mTotalSize( 0 ) {
+
+			if ( !isGzip( mFile ) ) {
+				throw runtime_error( "Input is not gzip-compressed!" );
+			}
+			if ( mFile.size() < 18 ) {
+				throw runtime_error( "Truncated gzip input!" );
+			}
+
+			// BGZF: collect block boundaries and uncompressed sizes from the block headers and trailers
+			if ( bgzfBlockSize( mFile.begin(), mFile.size() ) > 0 ) {
+				mIsBgzf = true;
+				size_t offset = 0;
+				while ( offset < mFile.size() ) {
+					const size_t blockSize = bgzfBlockSize( mFile.begin() + offset, mFile.size() - offset );
+					if ( blockSize == 0 || offset + blockSize > mFile.size() ) {
+						throw runtime_error( "Corrupt BGZF block at byte " + to_string( offset ) + "!" );
+					}
+					mBlockOffsets.push_back( offset );
+					mBlockSizes.push_back( readLittleEndian( mFile.begin() + offset + blockSize - 4, 4 ) );
+					mTotalSize += mBlockSizes.back();
+					offset += blockSize;
+				}
+				mBlockOffsets.push_back( offset );
+			} else {
+				mStream.zalloc = Z_NULL;
+				mStream.zfree = Z_NULL;
+				mStream.opaque = Z_NULL;
+				mStream.next_in = Z_NULL;
+				mStream.avail_in = 0;
+				if ( inflateInit2( &mStream, 15 + 16 ) != Z_OK ) {
+					throw runtime_error( "Cannot initialize zlib!" );
+				}
+				mStreamOpen = true;
+
+			}
+
+			// decompress the first chunk right away, so it can be inspected using peek()
+			mHasNextChunk = decompress( mNextChunk );
+
+			// the gzip trailer only stores the uncompressed size modulo 2^32, so choose the size consistent with it that is closest to an extrapolation of the compression ratio of the first chunk
+			if ( !mIsBgzf ) {
+				const size_t modulus = ( size_t ) 1 << 32;
+				const size_t consumed = mInputOffset - mStream.avail_in;
+				if ( mInputDone ) {
+					mTotalSize = mNextChunk.size();
+				} else {
+					const double estimate = ( double ) mNextChunk.size() / max( consumed, ( size_t ) 1 ) * mFile.size();
+					mTotalSize = readLittleEndian( mFile.end() - 4, 4 );
+					while ( mTotalSize + modulus / 2 < estimate ) {
+						mTotalSize += modulus;
+					}
+				}
+			}
+		}
+
+		~GzipDecompressor() {
+			if ( mPrefetch.joinable() ) {
+				mPrefetch.join();
+			}
+			if ( mStreamOpen ) {
+				inflateEnd( &mStream );
+			}
+		}
+
+		// Swap the next decompressed chunk into <chunk> and start decompressing the following one. Returns false at the end of the input.
+		bool next( vector<char>& chunk ) {
+			waitForPrefetch();
+			if ( !mHasNextChunk ) {
+				return false;
+			}
+			chunk.swap( mNextChunk );
+			mPrefetch = thread( [this]() {
+				try {
+					mHasNextChunk = decompress( mNextChunk );
+				} catch ( ... ) {
+					mPrefetchError = current_exception();
+				}
+			} );
+			return true;
+		}
+
+		// The first chunk, before next() is called for the first time.
+		const vector<char>& peek() const {
+			return mNextChunk;
+		}
+
+		// The total uncompressed size, which is exact for BGZF and an estimate for plain gzip.
+		size_t totalSize() const {
+			return mTotalSize;
+		}
+};
+
+
+
+// Reads whitespace-separated values from a gzip-compressed text file, parsing one chunk while the next one is decompressed.
+class GzipReader : public Reader {
+
+		GzipDecompressor mGzip;
+		vector<char> mChunk;
+
+		// parsing state: tokens in [mPos, mEnd) are complete, [mEnd, mChunkEnd) is the beginning of a token continued in the next chunk, which is assembled in mCarry
+		const char* mPos;
+		const char* mEnd;
+		const char* mChunkEnd;
+		string mCarry;
+		const char* mCarryPos;
+		bool mFinished;
+
+		size_t mSizeHint;
+
+
+		// Move on to the next chunk. The incomplete token at the end of the current chunk is completed with the beginning of the next chunk(s) in mCarry. Returns false if there is nothing left to parse.
+		bool advance() {
+			string carry( mEnd, mChunkEnd );
+			mPos = mEnd = mChunkEnd;
+			if ( mFinished ) {
+				return false;
+			}
+			for ( ;; ) {
+				if ( !mGzip.next( mChunk ) ) {
+					mFinished = true;
+					mCarry.swap( carry );
+					mCarryPos = mCarry.data();
+					return !mCarry.empty();
+				}
+				const char* begin = mChunk.data();
+				const char* end = begin + mChunk.size();
+				const char* firstSpace = begin;
+				while ( firstSpace < end && !isSpace( *firstSpace ) ) {
+					firstSpace++;
+				}
+				carry.append( begin, firstSpace );
+				if ( firstSpace < end ) {
+					const char* lastSpace = end - 1;
+					while ( !isSpace( *lastSpace ) ) {
+						lastSpace--;
+					}
+					mPos = firstSpace;
+					mEnd = lastSpace + 1;
+					mChunkEnd = end;
+					mCarry.swap( carry );
+					mCarryPos = mCarry.data();
+					return true;
+				}
+			}
+		}
+
+
+	public:
+
+		// delete copy constructor
+		GzipReader( const GzipReader& that ) = delete;
+
+		GzipReader(
+		    const MappedFile& file,
+		    const size_t nrThreads = 1 ) :
+			mGzip( file, nrThreads ),
+			mPos( nullptr ),
+			mEnd( nullptr ),
+			mChunkEnd( nullptr ),
+			mCarryPos( nullptr ),
+			mFinished( false ),
+			mSizeHint( 0 ) {
+
+			// extrapolate the number of values from the first chunk
+			const vector<char>& first = mGzip.peek();
+			if ( first.size() > 0 ) {
+				const double valuesPerByte = ( double ) countTokens( first.data(), first.data() + first.size() ) / first.size();
+				mSizeHint = 1.01 * valuesPerByte * mGzip.totalSize() + 1;
+			}
+		}
+
+		size_t read(
+		    real_t* values,
+		    const size_t maxNrValues ) {
+			size_t n = 0;
+			for ( ;; ) {
+				if ( mCarryPos != nullptr ) {
+					n += scanText( mCarryPos, mCarry.data() + mCarry.size(), values + n, maxNrValues - n );
+				}
+				n += scanText( mPos, mEnd, values + n, maxNrValues - n );
+				if ( n == maxNrValues || !advance() ) {
+					return n;
+				}
+			}
+		}
+
+		size_t sizeHint() const {
+			return mSizeHint;
+		}
+};
+
+
+#endif
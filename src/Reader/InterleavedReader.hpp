@@ -0,0 +1,110 @@
+#ifndef INTERLEAVEDREADER_HPP
+#define INTERLEAVEDREADER_HPP
+
+#include "../Reader.hpp"
+
+
+// Combines several readers, e.g. one per input file, into a single multivariate input: each source provides one or more dimensions per position, and all sources are read in lockstep and interleaved position by position. All sources must contain the same number of positions.
+class InterleavedReader : public Reader {
+
+		struct Source {
+			unique_ptr<Reader> reader;
+			size_t nrDim;
+			vector<real_t> buffer;
+			size_t pos;	// next value in buffer
+			size_t size;	// number of valid values in buffer
+			bool finished;
+		};
+
+		vector<Source> mSources;
+		size_t mNrDim;
+
+
+		// Make sure that <source> has at least <nrValues> values buffered, unless its input ends. Returns false if fewer values are available.
+		bool fill(
+		    Source& source,
+		    const size_t nrValues ) {
+			while ( source.size - source.pos < nrValues && !source.finished ) {
+				// move remaining values to the front and read more
+				const size_t remaining = source.size - source.pos;
+				for ( size_t i = 0; i < remaining; ++i ) {
+					source.buffer[i] = source.buffer[source.pos + i];
+				}
+				source.pos = 0;
+				source.size = remaining;
+				const size_t n = source.reader->read( source.buffer.data() + source.size, source.buffer.size() - source.size );
+				if ( n == 0 ) {
+					source.finished = true;
+				}
+				source.size += n;
+			}
+			return source.size - source.pos >= nrValues;
+		}
+
+	public:
+
+		// delete copy constructor
+		InterleavedReader( const InterleavedReader& that ) = delete;
+
+		// Each source with unknown dimensionality (nrDim() == 0) is treated as univariate.
+		InterleavedReader(
+		    vector<unique_ptr<Reader>>& sources ) :
+			mNrDim( 0 ) {
+			if ( sources.size() == 0 ) {
+				throw runtime_error( "No input sources to interleave!" );
+			}
+			for ( auto & reader : sources ) {
+				const size_t nrDim = max( reader->nrDim(), ( size_t ) 1 );
+				mSources.push_back( Source{std::move( reader ), nrDim, vector<real_t>( nrDim << 12 ), 0, 0, false} );
+				mNrDim += nrDim;
+			}
+			sources.clear();
+		}
+
+		size_t read(
+		    real_t* values,
+		    const size_t maxNrValues ) {
+			if ( maxNrValues < mNrDim ) {
+				throw runtime_error( "Buffer too small for interleaved input!" );
+			}
+			size_t n = 0;
+			while ( n + mNrDim <= maxNrValues ) {
+				size_t nrExhausted = 0;
+				for ( auto & source : mSources ) {
+					if ( !fill( source, source.nrDim ) ) {
+						if ( source.size > source.pos ) {
+							throw runtime_error( "Input did not contain enough values to fill all dimensions at last position!" );
+						}
+						nrExhausted++;
+					}
+				}
+				if ( nrExhausted == mSources.size() ) {
+					break;
+				} else if ( nrExhausted > 0 ) {
+					throw runtime_error( "Input files contain different numbers of positions!" );
+				}
+				for ( auto & source : mSources ) {
+					for ( size_t d = 0; d < source.nrDim; ++d ) {
+						values[n++] = source.buffer[source.pos++];
+					}
+				}
+			}
+			return n;
+		}
+
+		// the largest number of positions among all sources, times the total number of dimensions
+		size_t sizeHint() const {
+			size_t nrPositions = 0;
+			for ( auto & source : mSources ) {
+				nrPositions = max( nrPositions, source.reader->sizeHint() / source.nrDim );
+			}
+			return nrPositions * mNrDim;
+		}
+
+		size_t nrDim() const {
+			return mNrDim;
+		}
+};
+
+
+#endif
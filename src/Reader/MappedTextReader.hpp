@@ -0,0 +1,234 @@
+#ifndef MAPPEDTEXTREADER_HPP
+#define MAPPEDTEXTREADER_HPP
+
+#include "../Reader.hpp"
+#include "../MappedFile.hpp"
+
+#include <cstdlib>
+using std::strtof;
+
+#include <cstring>
+using std::memchr;
+using std::memcpy;
+
+#include <cerrno>
+
+
+// check for the characters that istream treats as whitespace in the "C" locale
+inline bool isSpace( const char c ) {
+	return c == ' ' || ( c >= '\t' && c <= '\r' );
+}
+
+inline bool isDigit( const char c ) {
+	return c >= '0' && c <= '9';
+}
+
+
+// Scan a floating point number from [pos, end), accepting the same syntax as istream >> float, i.e. [+-]digits[.digits][(e|E)[+-]digits]. Returns a pointer past the last character consumed, or nullptr if no valid number starts at pos.
+// Short mantissas with small exponents are converted exactly using a single correctly rounded float operation; everything else is handed to strtof, so the result is always identical to what istream produces.
+inline const char* scanReal(
+    const char* pos,
+    const char* end,
+    real_t& value ) {
+
+	// exact powers of 10 representable in a float
+	static const real_t pow10[] = {1e0f, 1e1f, 1e2f, 1e3f, 1e4f, 1e5f, 1e6f, 1e7f, 1e8f, 1e9f, 1e10f};
+	const uint64_t maxExactMantissa = ( uint64_t ) 1 << numeric_limits<real_t>::digits;
+
+	const char* start = pos;
+	bool negative = false;
+	if ( pos < end && ( *pos == '-' || *pos == '+' ) ) {
+		negative = ( *pos == '-' );
+		pos++;
+	}
+
+	uint64_t mantissa = 0;
+	size_t nrDigits = 0;	// significant digits accumulated in mantissa
+	long exponent = 0;
+	bool anyDigits = false;
+	bool exact = true;
+
+	for ( ; pos < end && isDigit( *pos ); ++pos ) {
+		anyDigits = true;
+		if ( nrDigits < 19 ) {
+			mantissa = 10 * mantissa + ( *pos - '0' );
+			if ( mantissa > 0 ) {
+				nrDigits++;
+			}
+		} else {
+			exact = false;
+		}
+	}
+	if ( pos < end && *pos == '.' ) {
+		pos++;
+		for ( ; pos < end && isDigit( *pos ); ++pos ) {
+			anyDigits = true;
+			if ( nrDigits < 19 ) {
+				mantissa = 10 * mantissa + ( *pos - '0' );
+				exponent--;
+				if ( mantissa > 0 ) {
+					nrDigits++;
+				}
+			} else {
+				exact = false;
+			}
+		}
+	}
+	if ( !anyDigits ) {
+		return nullptr;
+	}
+	if ( pos < end && ( *pos == 'e' || *pos == 'E' ) ) {
+		pos++;
+		bool negativeExponent = false;
+		if ( pos < end && ( *pos == '-' || *pos == '+' ) ) {
+			negativeExponent = ( *pos == '-' );
+			pos++;
+		}
+		if ( pos >= end || !isDigit( *pos ) ) {
+			return nullptr;	// NOTE istream rejects a dangling exponent as well
+		}
+		long e = 0;
+		for ( ; pos < end && isDigit( *pos ); ++pos ) {
+			if ( e < 100000 ) {
+				e = 10 * e + ( *pos - '0' );
+			}
+		}
+		exponent += ( negativeExponent ? -e : e );
+	}
+
+	if ( exact && mantissa <= maxExactMantissa && exponent >= -10 && exponent <= 10 ) {
+		value = ( real_t ) mantissa;
+		if ( exponent < 0 ) {
+			value /= pow10[-exponent];
+		} else {
+			value *= pow10[exponent];
+		}
+		if ( negative ) {
+			value = -value;
+		}
+	} else {
+		// slow path: copy the token to a null-terminated buffer and let the C library do the rounding
+		char buffer[128];
+		const size_t length = pos - start;
+		if ( length >= sizeof( buffer ) ) {
+			string token( start, length );
+			errno = 0;
+			value = strtof( token.c_str(), nullptr );
+		} else {
+			memcpy( buffer, start, length );
+			buffer[length] = '\0';
+			errno = 0;
+			value = strtof( buffer, nullptr );
+		}
+		if ( !isfinite( value ) ) {
+			return nullptr;	// NOTE istream fails on overflow
+		}
+	}
+	return pos;
+}
+
+
+
+// Parse whitespace-separated values from [pos, end) into <values>, until either <maxNrValues> values have been read or the end is reached. <pos> is advanced past the last value read. The caller has to make sure that the last token is not truncated.
+inline size_t scanText(
+    const char*& pos,
+    const char* end,
+    real_t* values,
+    const size_t maxNrValues ) {
+	size_t n = 0;
+	while ( n < maxNrValues ) {
+		while ( pos < end && isSpace( *pos ) ) {
+			pos++;
+		}
+		if ( pos >= end ) {
+			break;
+		}
+		const char* next = scanReal( pos, end, values[n] );
+		if ( next == nullptr ) {
+			const char* tokenEnd = pos;
+			while ( tokenEnd < end && !isSpace( *tokenEnd ) && tokenEnd - pos < 20 ) {
+				tokenEnd++;
+			}
+			throw runtime_error( "Invalid input encountered: \"" + string( pos, tokenEnd ) + "\"!" );
+		}
+		pos = next;
+		n++;
+	}
+	return n;
+}
+
+
+// count the number of newline characters in [begin, end)
+inline size_t countLines(
+    const char* begin,
+    const char* end ) {
+	size_t count = 0;
+	for ( const char* p = begin; p < end; ++count ) {
+		p = ( const char* ) memchr( p, '\n', end - p );
+		if ( p == nullptr ) {
+			break;
+		}
+		p++;
+	}
+	return count;
+}
+
+
+
+// count the number of whitespace-separated tokens in [begin, end)
+inline size_t countTokens(
+    const char* begin,
+    const char* end ) {
+	size_t count = 0;
+	bool inToken = false;
+	for ( const char* p = begin; p < end; ++p ) {
+		const bool space = isSpace( *p );
+		count += ( !space && !inToken );
+		inToken = !space;
+	}
+	return count;
+}
+
+
+
+// Reads whitespace-separated values from a memory-mapped text file, bypassing the locale-aware istream extraction.
+class MappedTextReader : public Reader {
+
+		const MappedFile& mFile;
+		const char* mPos;
+		size_t mSizeHint;
+
+	public:
+
+		MappedTextReader(
+		    const MappedFile& file ) :
+			mFile( file ),
+			mPos( file.begin() ),
+			mSizeHint( 0 ) {
+
+			if ( !mFile.isOpen() ) {
+				throw runtime_error( "Cannot read input file or stream!" );
+			}
+
+			// estimate the number of values from the number of lines and the number of values on the first line; this is much cheaper than parsing
+			mSizeHint = countLines( mFile.begin(), mFile.end() );
+			if ( mFile.size() > 0 && mFile.end()[-1] != '\n' ) {
+				mSizeHint++;	// last line is not terminated
+			}
+			const char* firstLineEnd = ( const char* ) memchr( mFile.begin(), '\n', mFile.size() );
+			mSizeHint *= max( countTokens( mFile.begin(), firstLineEnd != nullptr ? firstLineEnd : mFile.end() ), ( size_t ) 1 );
+		}
+
+		size_t read(
+		    real_t* values,
+		    const size_t maxNrValues ) {
+			return scanText( mPos, mFile.end(), values, maxNrValues );
+		}
+
+		size_t sizeHint() const {
+			return mSizeHint;
+		}
+};
+
+
+#endif
@@ -0,0 +1,119 @@
+#ifndef PIPELINEDREADER_HPP
+#define PIPELINEDREADER_HPP
+
+#include "../Reader.hpp"
+#include "../Parallel.hpp"
+
+#include <cstring>
+using std::memcpy;
+
+
+const size_t PIPELINE_BLOCK_SIZE = 1 << 14;	// number of values per block handed from the producer to the consumer
+const size_t PIPELINE_NR_BLOCKS = 16;	// number of blocks in the ring buffer
+
+
+// Runs another reader on a separate producer thread, so that reading, decompressing and parsing overlap with the consumer, i.e. the maxlet transform. Parsed values are passed in blocks through a lock-free ring buffer, and a thread that has to wait for the other one blocks after a short spin.
+class PipelinedReader : public Reader {
+
+		struct Block {
+			vector<real_t> values;
+			size_t size;	// 0 marks the end of the input
+		};
+
+		unique_ptr<Reader> mSource;
+		SpscRing<Block> mRing;
+		Block* mCurrent;	// block being consumed
+		size_t mOffset;	// next value in mCurrent
+		bool mFinished;
+
+		atomic<bool> mStop;	// tells the producer to quit early, e.g. if the consumer throws
+		exception_ptr mError;	// exception thrown by the source, rethrown by the consumer
+		thread mProducer;
+
+
+		void produce() {
+			for ( ;; ) {
+				Block* block = mRing.waitBack( mStop );
+				if ( block == nullptr ) {
+					return;
+				}
+				try {
+					block->size = mSource->read( block->values.data(), block->values.size() );
+				} catch ( ... ) {
+					mError = current_exception();
+					block->size = 0;
+				}
+				mRing.push();
+				if ( block->size == 0 ) {
+					return;
+				}
+			}
+		}
+
+	public:
+
+		// delete copy constructor
+		PipelinedReader( const PipelinedReader& that ) = delete;
+
+		PipelinedReader(
+		    unique_ptr<Reader> source ) :
+			mSource( std::move( source ) ),
+			mRing( PIPELINE_NR_BLOCKS, Block{vector<real_t>( PIPELINE_BLOCK_SIZE ), 0} ),
+			mCurrent( nullptr ),
+			mOffset( 0 ),
+			mFinished( false ),
+			mStop( false ) {
+			mProducer = thread( &PipelinedReader::produce, this );
+		}
+
+		~PipelinedReader() {
+			mStop = true;
+			mRing.wake();
+			mProducer.join();
+		}
+
+		size_t read(
+		    real_t* values,
+		    const size_t maxNrValues ) {
+			size_t n = 0;
+			while ( n < maxNrValues && !mFinished ) {
+				if ( mCurrent == nullptr ) {
+					mCurrent = mRing.front();
+					if ( mCurrent == nullptr ) {
+						if ( n > 0 ) {
+							break;	// return what we have instead of waiting
+						}
+						mCurrent = mRing.waitFront();
+					}
+					mOffset = 0;
+					if ( mCurrent->size == 0 ) {
+						mFinished = true;
+						if ( mError ) {
+							rethrow_exception( mError );
+						}
+						break;
+					}
+				}
+				const size_t k = min( maxNrValues - n, mCurrent->size - mOffset );
+				memcpy( values + n, mCurrent->values.data() + mOffset, k * sizeof( real_t ) );
+				n += k;
+				mOffset += k;
+				if ( mOffset == mCurrent->size ) {
+					mRing.pop();
+					mCurrent = nullptr;
+				}
+			}
+			return n;
+		}
+
+		size_t sizeHint() const {
+			return mSource->sizeHint();
+		}
+
+		size_t nrDim() const {
+			return mSource->nrDim();
+		}
+};
+
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef RUNLENGTHREADER_HPP
+#define RUNLENGTHREADER_HPP
+
+#include "../Reader.hpp"
+#include "../MappedFile.hpp"
+#include "MappedTextReader.hpp"
+
+
+// Reads run-length encoded text, where each run consists of the values of all <nrDim> dimensions, followed by the number of consecutive positions that share these values, all separated by whitespace. Values are parsed like MappedTextReader does, bypassing the locale-aware istream extraction. Runs can either be taken one at a time using nextRun(), or expanded into values using read().
+class RunLengthReader : public Reader {
+
+		const char* mPos;
+		const char* mEnd;
+		const size_t mNrDim;
+		size_t mNrRuns;
+
+		// the run that is currently being expanded by read(), and the number of its positions that are left
+		vector<real_t> mRun;
+		size_t mRemaining;
+
+
+		// skip whitespace, and return whether a token follows
+		bool nextToken() {
+			while ( mPos < mEnd && isSpace( *mPos ) ) {
+				mPos++;
+			}
+			return mPos < mEnd;
+		}
+
+		// Scan a positive integer run length. Returns false if the token is not a positive integer.
+		bool scanLength( size_t& length ) {
+			const char* pos = mPos;
+			if ( pos < mEnd && *pos == '+' ) {
+				pos++;
+			}
+			length = 0;
+			const char* digits = pos;
+			for ( ; pos < mEnd && isDigit( *pos ); ++pos ) {
+				if ( length > ( numeric_limits<size_t>::max() - 9 ) / 10 ) {
+					return false;
+				}
+				length = 10 * length + ( *pos - '0' );
+			}
+			if ( pos == digits || length == 0 || ( pos < mEnd && !isSpace( *pos ) ) ) {
+				return false;
+			}
+			mPos = pos;
+			return true;
+		}
+
+	public:
+
+		// Parse the text in [begin, end), which has to outlive the reader.
+		RunLengthReader(
+		    const char* begin,
+		    const char* end,
+		    const size_t nrDim = 1 ) :
+			mPos( begin ),
+			mEnd( end ),
+			mNrDim( nrDim ),
+			mNrRuns( 0 ),
+			mRun( nrDim ),
+			mRemaining( 0 ) {
+			if ( mNrDim <= 0 ) {
+				throw runtime_error( "Number of dimensions must be positive!" );
+			}
+		}
+
+		RunLengthReader(
+		    const MappedFile& file,
+		    const size_t nrDim = 1 ) :
+			RunLengthReader( file.begin(), file.end(), nrDim ) {
+			if ( !file.isOpen() ) {
+				throw runtime_error( "Cannot read input file or stream!" );
+			}
+		}
+
+		// Read the next run into <values> (nrDim values) and <length>. Returns false at the end of the input.
+		bool nextRun(
+		    real_t* values,
+		    size_t& length ) {
+			for ( size_t d = 0; d < mNrDim; ++d ) {
+				if ( !nextToken() ) {
+					if ( d == 0 ) {
+						return false;
+					}
+					throw runtime_error( "Run " + to_string( mNrRuns + 1 ) + " needs a positive run length after " + to_string( mNrDim ) + " value(s)!" );
+				}
+				const char* next = scanReal( mPos, mEnd, values[d] );
+				if ( next == nullptr || ( next < mEnd && !isSpace( *next ) ) ) {
+					throw runtime_error( "Invalid input encountered in run " + to_string( mNrRuns + 1 ) + "!" );
+				}
+				mPos = next;
+			}
+			if ( !nextToken() || !scanLength( length ) ) {
+				throw runtime_error( "Run " + to_string( mNrRuns + 1 ) + " needs a positive run length after " + to_string( mNrDim ) + " value(s)!" );
+			}
+			mNrRuns++;
+			return true;
+		}
+
+		// expand the runs into values, nrDim per position
+		size_t read(
+		    real_t* values,
+		    const size_t maxNrValues ) {
+			size_t n = 0;
+			while ( n + mNrDim <= maxNrValues ) {
+				if ( mRemaining == 0 && !nextRun( mRun.data(), mRemaining ) ) {
+					break;
+				}
+				for ( ; mRemaining > 0 && n + mNrDim <= maxNrValues; --mRemaining ) {
+					for ( size_t d = 0; d < mNrDim; ++d ) {
+						values[n++] = mRun[d];
+					}
+				}
+			}
+			return n;
+		}
+
+		size_t nrDim() const {
+			return mNrDim;
+		}
+};
+
+
+#endif
@@ -0,0 +1,45 @@
+#ifndef STREAMREADER_HPP
+#define STREAMREADER_HPP
+
+#include "../Reader.hpp"
+#include "../utils.hpp"
+
+
+// Reads whitespace-separated values from an input stream, e.g. STDIN. This is the fallback for input that cannot be memory-mapped.
+class StreamReader : public Reader {
+
+		istream& mInput;
+		size_t mSizeHint;
+
+	public:
+
+		StreamReader(
+		    istream& input,
+		    const size_t sizeHint = 0 ) :
+			mInput( input ),
+			mSizeHint( sizeHint ) {
+			if ( !mInput ) {
+				throw runtime_error( "Cannot read input file or stream!" );
+			}
+		}
+
+		size_t read(
+		    real_t* values,
+		    const size_t maxNrValues ) {
+			size_t n = 0;
+			while ( n < maxNrValues && mInput >> values[n] ) {
+				n++;
+			}
+			if ( n < maxNrValues && !mInput.eof() ) {
+				throw runtime_error( "Invalid input encountered!" );
+			}
+			return n;
+		}
+
+		size_t sizeHint() const {
+			return mSizeHint;
+		}
+};
+
+
+#endif
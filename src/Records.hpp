@@ -31,6 +31,7 @@ class Records {
 
 
 		StateMarginals mMarginals;
+		const GenomeMap* mGenomeMap;	// genome coordinates for the marginals, if available
 
 		bool mRecordMarginals;
 		bool mRecordBlocks;
@@ -86,6 +87,7 @@ class Records {
 			mPrefix( prefix ),
 			mSuffix( suffix ),
 			mMarginals( T ),
+			mGenomeMap( nullptr ),
 			mRecordMarginals( true ),
 			mRecordSegments( false ),
 			mRecordBlocks( false ),
@@ -102,7 +104,7 @@ class Records {
 
 		void close() {
 			if ( mRecordMarginals ) {
-				mMarginals.save( mMarginalsFile );
+				mMarginals.save( mMarginalsFile, 1, false, mGenomeMap );
 				mMarginalsFile.close();
 			}
 			if ( mRecordSequences ) {
@@ -119,6 +121,11 @@ class Records {
 			}
 		}
 
+		// write genome coordinates for each segment of the marginals
+		void setGenomeMap( const GenomeMap* genomeMap ) {
+			mGenomeMap = genomeMap;
+		}
+
 		void setRecordMarginals( bool b, bool overwrite = false ) {
 			setRecordX( mMarginalsFile, "marginals", mRecordMarginals, b, overwrite );
 		}
@@ -4,6 +4,7 @@
 #include "includes.hpp"
 
 #include "StateMarginalsIterator.hpp"
+#include "GenomeMap.hpp"
 
 #include <deque>
 using std::deque;
@@ -268,7 +269,8 @@ class StateMarginals {
 		void save(
 		    ofstream& ofs,
 		    size_t chunkSize = 1, // multiply the segment size by this number in the output file
-		    bool verbose = false
+		    bool verbose = false,
+		    const GenomeMap* genome = nullptr	// if provided, segments are split at genome runs, and each line starts with refseq, start and (inclusive) end
 		) const  {	// NOTE since marginals are stores only up to the largest state that has non-zero counts for space efficiency reasons, nrStates can be used to fill the remaining counts with zero. Otherwise, these states are not written.
 			if ( chunkSize <= 0 ) {
 				throw runtime_error( "Chunk size must be at least one!" );
@@ -279,30 +281,46 @@ class StateMarginals {
 
 			size_t i = 0;
 			marginal_t s = 0;
+			size_t index = 0;	// data position of the current segment
+			size_t run = 0;	// genome run containing index
 			for ( size_t segSize : mSizeQ ) {
 				size_t iterations = 0;
 
 				s = 0;
-				ofs << segSize;
+				ostringstream counts;
 				while ( mCountQ[i] != 0 ) {
 					if ( mCountQ[i] > 0 ) {
 						while ( s < mCountQ[i] ) {
-							ofs << "\t" << 0;
+							counts << "\t" << 0;
 							s++;
 						}
 					} else {
 						s++;
-						ofs << "\t" << -mCountQ[i];
+						counts << "\t" << -mCountQ[i];
 						iterations -= mCountQ[i];
 					}
 					i++;
 				}
 				while ( s < mNrStates ) {
-					ofs << "\t" << 0;
+					counts << "\t" << 0;
 					s++;
 				}
 				i++;	// skip over zero
-				ofs << endl;
+
+				if ( genome == nullptr ) {
+					ofs << segSize << counts.str() << endl;
+				} else {
+					const size_t segEnd = index + segSize;
+					for ( size_t start = index; start < segEnd; ) {
+						while ( run + 1 < genome->nrRuns() && genome->runStart( run + 1 ) <= start ) {
+							run++;
+						}
+						const size_t end = ( run + 1 < genome->nrRuns() ? min( segEnd, genome->runStart( run + 1 ) ) : segEnd );
+						ofs << genome->refseq( run ) << "\t" << genome->pos( run, start ) << "\t" << genome->pos( run, end - 1 ) << "\t" << end - start << counts.str() << endl;
+						start = end;
+					}
+				}
+				index += segSize;
 				if ( iterations != mNrIterations ) {
 					throw runtime_error( "Sum of marginals (" + to_string( iterations ) + ") does not match the number of iterations (" + to_string( mNrIterations ) + ")!" );
 				}
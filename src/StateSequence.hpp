@@ -11,6 +11,7 @@
 #include "KahanAggregator.hpp"
 #include "Trellis.hpp"
 #include "Records.hpp"
+#include "BlockTable.hpp"
 
 
 
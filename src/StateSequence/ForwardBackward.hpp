@@ -62,17 +62,26 @@ void StateSequence<ForwardBackward>::sample(
 	real_t prevN = 1;
 
 	// FORWARD FILTERING
-	y.initForward();
+	// both passes iterate over the materialized blocks, so the block structure and statistics are only evaluated once per block structure
+	const auto& blocks = y.blockTable();
 	vector<real_t> forward( nrStates, 0 );
-	while ( y.next() ) {
+	// the inner products are computed for batches of blocks, products[s * INNER_PRODUCT_BATCH_SIZE + i] holds the one of state s and the i-th block of the current batch
+	vector<real_t> products( nrStates * INNER_PRODUCT_BATCH_SIZE );
+	for ( size_t b = 0; b < blocks.nrBlocks(); ++b ) {
+		if ( b % INNER_PRODUCT_BATCH_SIZE == 0 ) {
+			const size_t count = min( INNER_PRODUCT_BATCH_SIZE, blocks.nrBlocks() - b );
+			for ( auto s = 0; s < nrStates; ++s ) {
+				blocks.innerProducts( b, count, theta.value(), theta.mapping( s ), &products[s * INNER_PRODUCT_BATCH_SIZE] );
+			}
+		}
 		++t;
 		real_t maxE = numeric_limits<real_t>::lowest();
 
 
-		real_t N = y.blockSize();	// typecasting to avoid integer division TODO maxBlockSize should be restricted by range of real_t (data_t)
+		real_t N = blocks.blockSize( b );	// typecasting to avoid integer division TODO maxBlockSize should be restricted by range of real_t (data_t)
 
 		for ( auto s = 0; s < nrStates; ++s ) {
-			auto E = innerProduct( y, theta.value(), theta.mapping( s ) )  - N * logNormalizers[s];	// TODO carrier measure for the general EFD case
+			auto E = products[s * INNER_PRODUCT_BATCH_SIZE + b % INNER_PRODUCT_BATCH_SIZE]  - N * logNormalizers[s];	// TODO carrier measure for the general EFD case
 			if ( useSelfTransitions ) {
 				E += ( N - 1 ) * logA[s];	// include self-transitions
 			}
@@ -165,7 +174,6 @@ void StateSequence<ForwardBackward>::sample(
 
 
 	// POSTERIOR RECORDING
-	// TODO is there any way to do the second iteration without recomputing stats?
 
 	vector<KahanAggregator<SufficientStatistics<StatsType>>> stats;
 	stats.resize( nrParams );
@@ -177,10 +185,8 @@ void StateSequence<ForwardBackward>::sample(
 	size_t prevState = 0;
 	t = 0;
 	marginal_t state;
-	y.initForward();
-	
-	while ( y.next() ) {
-		N = y.blockSize();
+	for ( size_t b = 0; b < blocks.nrBlocks(); ++b ) {
+		N = blocks.blockSize( b );
 		state = mStates[t];
 		transitions[state][state] += N - 1;
 		transitions[prevState][state] += 1;	// TODO Initial
@@ -188,7 +194,7 @@ void StateSequence<ForwardBackward>::sample(
 
 		for ( auto d = 0; d < nrDim; ++d ) {
 			// TODO assert range
-			stats[mapping[state][d]].add( y.suffStat( d ), N );
+			stats[mapping[state][d]].add( blocks.suffStat( b, d ), N );
 		}
 
 		if ( doRecord ) {
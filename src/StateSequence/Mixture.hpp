@@ -75,8 +75,8 @@ void StateSequence<Mixture>::sample(
 	// count states
 	SufficientStatistics<Categorical> stateCounts( nrStates );
 
-	// forward variables
-	y.initForward();
+	// iterate over the materialized blocks
+	const auto& blocks = y.blockTable();
 
 	// TODO initial
 	size_t prevState = 0;
@@ -87,15 +87,23 @@ void StateSequence<Mixture>::sample(
 // 		logStateProbs[d] = log( logStateProbs[d] );
 // 	}
 
-	while ( y.next() ) {
+	// the inner products are computed for batches of blocks, products[s * INNER_PRODUCT_BATCH_SIZE + i] holds the one of state s and the i-th block of the current batch
+	vector<real_t> products( nrStates * INNER_PRODUCT_BATCH_SIZE );
+	for ( size_t b = 0; b < blocks.nrBlocks(); ++b ) {
+		if ( b % INNER_PRODUCT_BATCH_SIZE == 0 ) {
+			const size_t count = min( INNER_PRODUCT_BATCH_SIZE, blocks.nrBlocks() - b );
+			for ( auto s = 0; s < nrStates; ++s ) {
+				blocks.innerProducts( b, count, theta.value(), theta.mapping( s ), &products[s * INNER_PRODUCT_BATCH_SIZE] );
+			}
+		}
 		real_t maxE = numeric_limits<real_t>::lowest();
 
-		const size_t N = y.blockSize();
+		const size_t N = blocks.blockSize( b );
 
 
 		// TODO assertions like in StateSequenceDirectGibbs
 		for ( auto s = 0; s < nrStates; ++s ) {
-			auto E = innerProduct( y, theta.value(), theta.mapping( s ) )  - N * logNormalizers[s]; // + N * logStateProbs[s];	// TODO carrier measure for the general EFD case TODO this is mixture sampling for burn-in, it does not take state probabilities into account
+			auto E = products[s * INNER_PRODUCT_BATCH_SIZE + b % INNER_PRODUCT_BATCH_SIZE]  - N * logNormalizers[s]; // + N * logStateProbs[s];	// TODO carrier measure for the general EFD case TODO this is mixture sampling for burn-in, it does not take state probabilities into account
 			weights[s] = E ;
 			maxE = max( E, maxE );
 		}
@@ -117,7 +125,7 @@ void StateSequence<Mixture>::sample(
 
 		for ( auto d = 0; d < nrDim; ++d ) {
 			// TODO assert range
-			stats[mapping[state][d]].add( y.suffStat( d ), N );
+			stats[mapping[state][d]].add( blocks.suffStat( b, d ), N );
 		}
 
 
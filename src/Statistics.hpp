@@ -9,6 +9,8 @@ class Statistics;
 #include "Blocks.hpp"
 
 #include "Statistics/IntegralArray.hpp"
+#include "Statistics/WaveletTree.hpp"
+#include "Statistics/PrefixSum.hpp"
 // #include "Statistics/Fixed.hpp"
 
 #endif
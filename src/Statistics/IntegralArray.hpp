@@ -8,6 +8,7 @@
 #include "../Tags.hpp"
 #include "../uintmath.hpp"
 #include "../KahanAggregator.hpp"
+#include "../Parallel.hpp"
 
 
 #include <algorithm>
@@ -57,9 +58,11 @@ class Statistics<IntegralArray, SuffStatType > {
 
 		Statistics( const Statistics& that ) = delete;
 
+		// NOTE the cells of the cumulative sums are independent, so they are computed on up to <nrThreads> threads
 		Statistics(
 		    vector<SufficientStatistics< SuffStatType>>& stats,
-		    const size_t nrDim	);
+		    const size_t nrDim,
+		    const size_t nrThreads = 1	);
 
 		template<typename T>
 		void setStats(
@@ -111,12 +114,12 @@ void Statistics<IntegralArray, SuffStatType >::addBlockStats(
 	size_t N = stats.nrTerms() + end - start;
 
 
-	stats.add( mStats( start , d ) );
+	stats.add( mStats.get( start, d ) );
 	for ( start = higher_mult( start, CELLSIZE ); start < end; start += CELLSIZE ) {
-		stats.add( mStats( start, d ) );
+		stats.add( mStats.get( start, d ) );
 	}
 	if ( end % CELLSIZE != 0 ) {
-		stats.subtract( mStats( end, d ) );
+		stats.subtract( mStats.get( end, d ) );
 	}
 
 	// manually set number of terms
@@ -135,7 +138,8 @@ void Statistics<IntegralArray, SuffStatType >::addBlockStats(
 template<typename SuffStatType>
 Statistics<IntegralArray, SuffStatType >::Statistics(
     vector<SufficientStatistics< SuffStatType>>& stats,
-    const size_t nrDim
+    const size_t nrDim,
+    const size_t nrThreads
 ) :
 	mSize( stats.size() / nrDim ),
 	mNrDim( nrDim ),
@@ -168,7 +172,7 @@ Statistics<IntegralArray, SuffStatType >::Statistics(
 
 	// move sufficient statistics to right and compute cumulative sums; Having the first entry be zero means we don't have to check for t=0 start positions and also don't worry about underflow of t
 
-	// TODO might cause reallocation
+	// NOTE MaxletTransform leaves capacity for these elements, so this does not reallocate
 	SufficientStatistics<SuffStatType> zero( 0 );
 	stats.reserve( stats.size() + mNrDim );
 	for ( size_t d = 0; d < mNrDim; ++d ) {
@@ -178,12 +182,14 @@ Statistics<IntegralArray, SuffStatType >::Statistics(
 
 	// compute the partial cumulative sums in subarrays, for all dimensions
 
+	// NOTE each cell and dimension is summed independently, so the result does not depend on the number of threads
 	const size_t skip = mNrDim * CELLSIZE;
-	for ( size_t start = 0; start < stats.size(); start += skip ) {
-		for ( size_t d = 0; d < mNrDim; ++d ) {
-			KahanCumulativeSum( stats, start + d, start + skip + d, mNrDim, true );
-		}
-	}
+	const size_t nrCells = ( stats.size() + skip - 1 ) / skip;
+	parallelFor( nrCells * mNrDim, nrThreads, [&]( size_t i ) {
+		const size_t start = ( i / mNrDim ) * skip;
+		const size_t d = i % mNrDim;
+		KahanCumulativeSum( stats, start + d, start + skip + d, mNrDim, true );
+	} );
 
 
 	mStats.swap( stats );
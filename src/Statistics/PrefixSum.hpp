@@ -0,0 +1,248 @@
+#ifndef STATISTICS_PREFIXSUM_HPP
+#define STATISTICS_PREFIXSUM_HPP
+
+#include "../Statistics.hpp"
+#include "../includes.hpp"
+#include "../SufficientStatistics.hpp"
+#include "../Tags.hpp"
+#include "../uintmath.hpp"
+#include "../Parallel.hpp"
+#include "../utils.hpp"
+
+
+const size_t PREFIX_SUM_CHUNK_SIZE = 1 << 16;	// the prefix sums are computed within chunks of this many positions in parallel, and the chunk offsets are added afterwards
+
+
+// Prefix sums of the sufficient statistics in AccumulatorType, over the whole input rather than per cell as in Statistics<IntegralArray>. The statistics of any block [start, end) are therefore a single subtraction per dimension and moment, regardless of the block size.
+// PrefixSum accumulates in double precision, at the cost of twice the memory of single-precision statistics. The squares are taken from the input statistics, so each of them has already been rounded to real_t before it is accumulated. Apart from that, the rounding error of a block is bounded by the precision of the prefix sums at its end, i.e. about 1e-16 times the sum over the input up to that point, which is comparable to the single precision of the result even for genome-scale inputs, see src/benchmarks/prefixSum.cpp.
+// IntegerPrefixSum accumulates integer data, e.g. read depths, exactly in 64-bit integers, so it needs neither cells nor compensated summation. The squares are computed from the values in integer arithmetic, so they are exact even where x*x is not representable as real_t. Use representable() to check whether the data qualifies.
+template<typename AccumulatorType>
+class Statistics<PrefixSums<AccumulatorType>, Normal> {
+
+		// number of input data points
+		const size_t mSize;
+
+		// number of input dimensions
+		const size_t mNrDim;
+
+		// mSums[d][t] is the sum of dimension d over positions [0, t), likewise for the squares in mSumSqs
+		vector<vector<AccumulatorType>> mSums;
+		vector<vector<AccumulatorType>> mSumSqs;
+
+
+		// current state during iteration
+		vector<SufficientStatistics<Normal>> mCurrentSuffStat;
+
+
+		// the value and squared value of a single data point in AccumulatorType
+		static void moments(
+		    const SufficientStatistics<Normal>& stats,
+		    AccumulatorType& sum,
+		    AccumulatorType& sumSq );
+
+	public:
+
+		Statistics( const Statistics& that ) = delete;
+
+		// NOTE the prefix sums are computed in chunks of fixed size, so the result does not depend on <nrThreads>. This throws unless representable( stats ) holds.
+		Statistics(
+		    vector<SufficientStatistics<Normal>>& stats,
+		    const size_t nrDim,
+		    const size_t nrThreads = 1	);
+
+		// Whether all values in <stats> can be accumulated exactly, which is always the case for floating point accumulators. For integer accumulators, all values must be integers, and the sums of their squares for each of the <nrDim> dimensions must fit into AccumulatorType.
+		static bool representable(
+		    const vector<SufficientStatistics<Normal>>& stats,
+		    const size_t nrDim );
+
+		template<typename T>
+		void setStats(
+		    const Blocks<T>& blocks );
+
+		const SufficientStatistics<Normal>& suffStat(
+		    size_t dim ) const;
+
+		size_t nrDim() const;
+
+		size_t size() const;
+
+};
+
+
+
+
+// NOTE this constructor releases the memory of its input vector, i.e. it is empty outside of this class
+template<typename AccumulatorType>
+Statistics<PrefixSums<AccumulatorType>, Normal>::Statistics(
+    vector<SufficientStatistics<Normal>>& stats,
+    const size_t nrDim,
+    const size_t nrThreads
+) :
+	mSize( stats.size() / nrDim ),
+	mNrDim( nrDim ),
+	mSums( nrDim ),
+	mSumSqs( nrDim ),
+	mCurrentSuffStat( nrDim, 0 ) {
+
+	// check that stats contain data
+	if ( mSize <= 0 ) {
+		throw runtime_error( "Input vector for sufficient statistics is empty!" );
+	}
+
+	if ( !divides( stats.size(), mNrDim ) ) {
+		throw runtime_error( "Cannot infer data dimension, size of statistics vector (" + to_string( stats.size() ) + ") must be multiple of " + to_string( mNrDim ) + "!" );
+	}
+
+	if ( !representable( stats, mNrDim ) ) {
+		throw runtime_error( "Exact prefix sums require integer data whose sum of squares fits into 64 bits!" );
+	}
+
+	for ( size_t d = 0; d < mNrDim; ++d ) {
+		mSums[d].assign( mSize + 1, 0 );
+		mSumSqs[d].assign( mSize + 1, 0 );
+	}
+
+	// sum each chunk on its own, shifted one position to the right so that the sum of [start, end) is P[end] - P[start]
+	const size_t nrChunks = ( mSize + PREFIX_SUM_CHUNK_SIZE - 1 ) / PREFIX_SUM_CHUNK_SIZE;
+	parallelFor( nrChunks * mNrDim, nrThreads, [&]( size_t i ) {
+		const size_t start = ( i / mNrDim ) * PREFIX_SUM_CHUNK_SIZE;
+		const size_t end = min( start + PREFIX_SUM_CHUNK_SIZE, mSize );
+		const size_t d = i % mNrDim;
+		AccumulatorType sum = 0;
+		AccumulatorType sumSq = 0;
+		for ( size_t t = start; t < end; ++t ) {
+			AccumulatorType x;
+			AccumulatorType xSq;
+			moments( stats[t * mNrDim + d], x, xSq );
+			sum += x;
+			sumSq += xSq;
+			mSums[d][t + 1] = sum;
+			mSumSqs[d][t + 1] = sumSq;
+		}
+	} );
+	deleteVector( stats );
+
+	// add the total of all previous chunks, first to the last entry of each chunk, which is the offset of the next one, then to the rest of the chunk
+	for ( size_t c = 1; c < nrChunks; ++c ) {
+		const size_t start = c * PREFIX_SUM_CHUNK_SIZE;
+		const size_t end = min( start + PREFIX_SUM_CHUNK_SIZE, mSize );
+		for ( size_t d = 0; d < mNrDim; ++d ) {
+			mSums[d][end] += mSums[d][start];
+			mSumSqs[d][end] += mSumSqs[d][start];
+		}
+	}
+	parallelFor( nrChunks * mNrDim, nrThreads, [&]( size_t i ) {
+		const size_t start = ( i / mNrDim ) * PREFIX_SUM_CHUNK_SIZE;
+		const size_t end = min( start + PREFIX_SUM_CHUNK_SIZE, mSize );
+		const size_t d = i % mNrDim;
+		if ( start == 0 ) {
+			return;
+		}
+		for ( size_t t = start + 1; t < end; ++t ) {
+			mSums[d][t] += mSums[d][start];
+			mSumSqs[d][t] += mSumSqs[d][start];
+		}
+	} );
+};
+
+
+
+
+// the value and squared value of a single data point in AccumulatorType
+template<typename AccumulatorType>
+void Statistics<PrefixSums<AccumulatorType>, Normal>::moments(
+    const SufficientStatistics<Normal>& stats,
+    AccumulatorType& sum,
+    AccumulatorType& sumSq ) {
+	sum = stats.sum();
+	sumSq = stats.sumSq();
+}
+
+
+// NOTE the square is computed in integer arithmetic rather than taken from <stats>, where it is rounded to real_t
+template<>
+void Statistics<IntegerPrefixSum, Normal>::moments(
+    const SufficientStatistics<Normal>& stats,
+    int64_t& sum,
+    int64_t& sumSq ) {
+	sum = ( int64_t ) stats.sum();
+	sumSq = sum * sum;
+}
+
+
+
+
+// Whether all values in <stats> can be accumulated exactly, which is always the case for floating point accumulators.
+template<typename AccumulatorType>
+bool Statistics<PrefixSums<AccumulatorType>, Normal>::representable(
+    const vector<SufficientStatistics<Normal>>&,
+    const size_t ) {
+	return true;
+}
+
+
+// Whether all values in <stats> are integers, and the sums of their squares for each of the <nrDim> dimensions fit into 64 bits.
+template<>
+bool Statistics<IntegerPrefixSum, Normal>::representable(
+    const vector<SufficientStatistics<Normal>>& stats,
+    const size_t nrDim ) {
+	// NOTE sums of absolute values are bounded by sums of squares for integers, so only the latter are checked
+	const long double maxSumSq = numeric_limits<int64_t>::max() / 2;
+	vector<long double> sumSqs( nrDim, 0 );
+	for ( size_t i = 0; i < stats.size(); ++i ) {
+		const real_t x = stats[i].sum();
+		if ( !( x == floor( x ) ) ) {
+			return false;	// also catches NaN and infinity
+		}
+		sumSqs[i % nrDim] += ( long double ) x * x;
+		if ( sumSqs[i % nrDim] > maxSumSq ) {
+			return false;
+		}
+	}
+	return true;
+}
+
+
+
+
+template<typename AccumulatorType>
+template<typename T>
+void Statistics<PrefixSums<AccumulatorType>, Normal>::setStats(
+    const Blocks<T>& blocks ) {
+	const size_t start = blocks.start();
+	const size_t end = blocks.end();
+	for ( size_t dim = 0; dim < mNrDim; ++dim ) {
+		mCurrentSuffStat[dim] = SufficientStatistics<Normal>( mSums[dim][end] - mSums[dim][start], mSumSqs[dim][end] - mSumSqs[dim][start] );
+	}
+}
+
+
+
+
+template<typename AccumulatorType>
+const SufficientStatistics<Normal>& Statistics<PrefixSums<AccumulatorType>, Normal>::suffStat( size_t dim ) const {
+	return mCurrentSuffStat[dim];
+
+}
+
+
+
+template<typename AccumulatorType>
+size_t Statistics<PrefixSums<AccumulatorType>, Normal>::nrDim() const {
+	return mNrDim;
+}
+
+
+
+template<typename AccumulatorType>
+size_t Statistics<PrefixSums<AccumulatorType>, Normal>::size() const {
+	return mSize;
+}
+
+
+
+
+
+
+
+#endif
@@ -0,0 +1,200 @@
+#ifndef STATISTICS_WAVELETTREE_HPP
+#define STATISTICS_WAVELETTREE_HPP
+
+#include "../Statistics.hpp"
+#include "../includes.hpp"
+#include "../SufficientStatistics.hpp"
+#include "../Tags.hpp"
+#include "../uintmath.hpp"
+
+#include "../MultiVector.hpp"
+
+
+const size_t WAVELET_TREE_MIN_LEVEL = 3;	// nodes smaller than 2^WAVELET_TREE_MIN_LEVEL are not stored, their statistics are summed from the data points instead
+
+
+// Sufficient statistics stored at the nodes of the wavelet tree, i.e. for all aligned dyadic intervals [s, s+2^k) with k >= WAVELET_TREE_MIN_LEVEL, in addition to the statistics of the individual data points. The statistics of a block of Blocks<WaveletTree> are therefore a single lookup per dimension, and any other block [start, end) is decomposed into O(log(end-start)) nodes. The node sums are computed pairwise, so unlike Statistics<IntegralArray> they do not require compensated summation, at the cost of 1/2^(WAVELET_TREE_MIN_LEVEL-1) additional memory.
+template<typename SuffStatType>
+class Statistics<WaveletTree, SuffStatType > {
+
+		// number of input data points
+		const size_t mSize;
+
+		// number of input dimensions
+		const size_t mNrDim;
+
+		// statistics of the individual data points
+		MultiVector<SufficientStatistics<SuffStatType>> mLeaves;
+
+		// node [s, s+2^k) is stored at position mLevelOffsets[k-WAVELET_TREE_MIN_LEVEL] + (s>>k), only nodes completely inside [0, mSize) are stored
+		MultiVector<SufficientStatistics<SuffStatType>> mNodes;
+		vector<size_t> mLevelOffsets;
+
+
+		// current state during iteration
+		vector<SufficientStatistics<SuffStatType>> mCurrentSuffStat;
+
+
+	public:
+
+		Statistics( const Statistics& that ) = delete;
+
+		Statistics(
+		    vector<SufficientStatistics< SuffStatType>>& stats,
+		    const size_t nrDim	);
+
+		template<typename T>
+		void setStats(
+		    const Blocks<T>& blocks );
+
+		const SufficientStatistics<SuffStatType>& suffStat(
+		    size_t dim ) const;
+
+		size_t nrDim() const;
+
+		size_t size() const;
+
+};
+
+
+
+
+
+
+
+
+
+
+
+
+// NOTE this constructor swaps its input vectors, i.e. they are empty outsize of this class
+template<typename SuffStatType>
+Statistics<WaveletTree, SuffStatType >::Statistics(
+    vector<SufficientStatistics< SuffStatType>>& stats,
+    const size_t nrDim
+) :
+	mSize( stats.size() / nrDim ),
+	mNrDim( nrDim ),
+	mLeaves( nrDim ),
+	mNodes( nrDim ),
+	mCurrentSuffStat( nrDim, 0 ) {
+
+	// check that stats contain data
+	if ( mSize <= 0 ) {
+		throw runtime_error( "Input vector for sufficient statistics is empty!" );
+	}
+
+	if ( !divides( stats.size(), mNrDim ) ) {
+		throw runtime_error( "Cannot infer data dimension, size of statistics vector (" + to_string( stats.size() ) + ") must be multiple of " + to_string( mNrDim ) + "!" );
+	}
+
+	// compute the offsets of all levels that contain at least one node
+	size_t nrNodes = 0;
+	for ( size_t level = WAVELET_TREE_MIN_LEVEL; ( mSize >> level ) > 0; ++level ) {
+		mLevelOffsets.push_back( nrNodes );
+		nrNodes += mSize >> level;
+	}
+	vector<SufficientStatistics<SuffStatType>> nodes( nrNodes * mNrDim, SufficientStatistics<SuffStatType>( 0 ) );
+
+	// the lowest level is summed from the data points, pairwise for numerical stability
+	if ( mLevelOffsets.size() > 0 ) {
+		const size_t nodeSize = ( size_t )1 << WAVELET_TREE_MIN_LEVEL;
+		vector<SufficientStatistics<SuffStatType>> partial( nodeSize );
+		for ( size_t i = 0; i < ( mSize >> WAVELET_TREE_MIN_LEVEL ); ++i ) {
+			for ( size_t d = 0; d < mNrDim; ++d ) {
+				for ( size_t t = 0; t < nodeSize; ++t ) {
+					partial[t] = stats[( i * nodeSize + t ) * mNrDim + d];
+				}
+				for ( size_t n = nodeSize / 2; n > 0; n /= 2 ) {
+					for ( size_t t = 0; t < n; ++t ) {
+						partial[t] += partial[t + n];
+					}
+				}
+				nodes[i * mNrDim + d] = partial[0];
+			}
+		}
+	}
+
+	// higher levels are the sums of their children
+	for ( size_t l = 1; l < mLevelOffsets.size(); ++l ) {
+		const size_t parents = mLevelOffsets[l];
+		const size_t children = mLevelOffsets[l - 1];
+		for ( size_t i = 0; children + 2 * i + 1 < parents; ++i ) {
+			for ( size_t d = 0; d < mNrDim; ++d ) {
+				nodes[( parents + i ) * mNrDim + d] = nodes[( children + 2 * i ) * mNrDim + d];
+				nodes[( parents + i ) * mNrDim + d] += nodes[( children + 2 * i + 1 ) * mNrDim + d];
+			}
+		}
+	}
+
+	mLeaves.swap( stats );
+	mNodes.swap( nodes );
+};
+
+
+
+
+template<typename SuffStatType>
+template<typename T>
+void Statistics<WaveletTree, SuffStatType >::setStats(
+    const Blocks<T>& blocks ) {
+
+	// decompose [start, end) into maximal aligned nodes, which for Blocks<WaveletTree> is the block itself
+	const size_t start = blocks.start();
+	const size_t end = blocks.end();
+	for ( size_t dim = 0; dim < mNrDim; ++dim ) {
+		mCurrentSuffStat[dim].clear();
+	}
+	for ( size_t s = start; s < end; ) {
+		size_t size = floorPow2( end - s );
+		if ( s > 0 ) {
+			size = min( size, klb( s ) );
+		}
+		size_t level = 0;
+		while ( ( ( size_t )1 << level ) < size ) {
+			level++;
+		}
+		if ( level >= WAVELET_TREE_MIN_LEVEL ) {
+			const size_t i = mLevelOffsets[level - WAVELET_TREE_MIN_LEVEL] + ( s >> level );
+			for ( size_t dim = 0; dim < mNrDim; ++dim ) {
+				mCurrentSuffStat[dim] += mNodes.get( i, dim );
+			}
+		} else {
+			for ( size_t t = s; t < s + size; ++t ) {
+				for ( size_t dim = 0; dim < mNrDim; ++dim ) {
+					mCurrentSuffStat[dim] += mLeaves.get( t, dim );
+				}
+			}
+		}
+		s += size;
+	}
+}
+
+
+
+
+template<typename SuffStatType>
+const SufficientStatistics<SuffStatType>& Statistics<WaveletTree, SuffStatType >::suffStat( size_t dim ) const {
+	return mCurrentSuffStat[dim];
+
+}
+
+
+template<typename SuffStatType>
+size_t Statistics<WaveletTree, SuffStatType >::nrDim() const {
+	return mNrDim;
+}
+
+
+template<typename SuffStatType>
+size_t Statistics<WaveletTree, SuffStatType >::size() const {
+	return mSize;
+}
+
+
+
+
+
+
+
+#endif
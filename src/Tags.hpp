@@ -1,6 +1,8 @@
 #ifndef TAGS_HPP
 #define TAGS_HPP
 
+#include <cstdint>
+
 
 enum MappingType {combinations, independent};
 
@@ -58,6 +60,9 @@ class Vector {}; // plain data structure for uncompressed sampling
 class WaveletTree {};
 class Fixed {};
 class IntegralArray {};
+template<typename AccumulatorType> class PrefixSums {};	// prefix sums over the whole input, accumulated in AccumulatorType
+using PrefixSum = PrefixSums<double>;
+using IntegerPrefixSum = PrefixSums<int64_t>;
 class Splittable {};
 class BreakpointArray {};
 
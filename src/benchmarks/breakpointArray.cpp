@@ -0,0 +1,232 @@
+// Compare the throughput of Blocks<BreakpointArray>::next(), whose 16-bit pointers are backed by a sparse second level of far pointers, against the previous layout with pointers capped at 2^16-1 positions, and against interleaved weight/pointer records, on flat and noisy data.
+
+#include "../includes.hpp"
+#include "../Tags.hpp"
+#include "../HMM.hpp"
+#include "../Emissions.hpp"
+#include "../Blocks.hpp"
+#include "../SufficientStatistics.hpp"
+#include "../wavelet.hpp"
+#include "../utils.hpp"
+#include "../Parser.hpp"
+
+#include <chrono>
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+#include <random>
+using std::mt19937;
+using std::normal_distribution;
+using std::uniform_int_distribution;
+
+#include <algorithm>
+using std::nth_element;
+
+
+// wall-clock seconds since <start>
+double secondsSince( const steady_clock::time_point& start ) {
+	return duration<double>( steady_clock::now() - start ).count();
+}
+
+
+// The previous layout: weights and 16-bit pointers in separate arrays, with pointers capped at 2^16-1 positions.
+class CappedArrays {
+
+		vector<real_t> mWeights;
+		vector<uint16_t> mPointers;
+
+	public:
+
+		CappedArrays( const vector<real_t>& weights ) :
+			mWeights( weights ) {
+			const size_t size = mWeights.size();
+			const uint16_t maxJumpSize = min( size, ( size_t )numeric_limits<uint16_t>::max() );
+			mPointers.assign( size, maxJumpSize );
+			deque<size_t> indexStack;
+			indexStack.push_back( 0 );
+			for ( size_t right = 1; right < size; ++right ) {
+				if ( right - indexStack.front() == maxJumpSize ) {
+					indexStack.pop_front();
+				}
+				while ( !indexStack.empty() && mWeights[indexStack.back()] <= mWeights[right] ) {
+					mPointers[indexStack.back()] = right - indexStack.back();
+					indexStack.pop_back();
+				}
+				indexStack.push_back( right );
+			}
+			while ( !indexStack.empty() ) {
+				mPointers[indexStack.back()] = size - indexStack.back();
+				indexStack.pop_back();
+			}
+		}
+
+		// number of blocks for <threshold>, using the same loop as the previous Blocks<BreakpointArray>::next()
+		size_t countBlocks( const real_t threshold ) const {
+			const size_t size = mWeights.size();
+			size_t nrBlocks = 0;
+			size_t end = 0;
+			while ( end < size ) {
+				nrBlocks++;
+				end++;
+				while ( end < size ) {
+					if ( mWeights[end] < threshold ) {
+						end += mPointers[end];
+					} else {
+						break;
+					}
+				}
+			}
+			return nrBlocks;
+		}
+
+		const vector<uint16_t>& pointers() const {
+			return mPointers;
+		}
+};
+
+
+// Weights and capped pointers interleaved into 8-byte records, so that each hop touches a single cache line.
+class InterleavedRecords {
+
+		struct Record {
+			real_t weight;
+			uint32_t pointer;
+		};
+		vector<Record> mRecords;
+
+	public:
+
+		InterleavedRecords( const vector<real_t>& weights, const vector<uint16_t>& pointers ) {
+			mRecords.reserve( weights.size() );
+			for ( size_t i = 0; i < weights.size(); ++i ) {
+				mRecords.push_back( Record{weights[i], pointers[i]} );
+			}
+		}
+
+		size_t countBlocks( const real_t threshold ) const {
+			const Record* records = mRecords.data();
+			const size_t size = mRecords.size();
+			size_t nrBlocks = 0;
+			size_t end = 0;
+			while ( end < size ) {
+				nrBlocks++;
+				end++;
+				while ( end < size && records[end].weight < threshold ) {
+					end += records[end].pointer;
+				}
+			}
+			return nrBlocks;
+		}
+};
+
+
+size_t countBlocks(
+    Blocks<BreakpointArray>& blocks,
+    const real_t threshold ) {
+	blocks.createBlocks( threshold );
+	blocks.initForward();
+	while ( blocks.next() ) {
+	}
+	return blocks.nrBlocks();
+}
+
+
+// run <f> repeatedly for at least <minSeconds>, and return the seconds per run
+template<typename F>
+double timePerRun(
+    F f,
+    const double minSeconds ) {
+	size_t nrRuns = 0;
+	const auto start = steady_clock::now();
+	do {
+		f();
+		nrRuns++;
+	} while ( secondsSince( start ) < minSeconds );
+	return secondsSince( start ) / nrRuns;
+}
+
+
+int main( int argc, const char* argv[] ) {
+
+	try {
+		Parser args( argc, argv );
+		args.registerFlags( {"-n", "-size"}, "16777216" );
+		args.registerFlags( {"-s", "-segment-length"}, "100000" );
+		args.registerFlags( {"-t", "-time"}, "0.5" );
+		args.registerFlags( {"-h", "--help", "-help"} );
+		args.parseArgs();
+
+		if ( args.isSet( "-h" ) ) {
+			cout << "Generates flat data (piecewise constant with segments of average length -s, default 10^5, and little noise) and noisy data (standard normal) with a given number of positions (-n, default 2^24), computes their breakpoint weights, and reports the time for a full pass of next() over the blocks, for thresholds that make 10%, 1%, 0.1% and 0.01% of the positions block boundaries. Each pass is repeated for at least -t seconds (default 0.5)." << endl;
+			return 0;
+		}
+
+		const size_t T = args.parse<size_t>( "-n" );
+		const size_t segmentLength = args.parse<size_t>( "-s" );
+		const double minSeconds = args.parse<double>( "-t" );
+
+		for ( const string dataType : {"flat", "noisy"} ) {
+			mt19937 RNG( 0 );
+			normal_distribution<real_t> normal( 0, 1 );
+			uniform_int_distribution<size_t> length( 1, 2 * segmentLength );
+			MaxletBuilder<Normal> builder;
+			real_t mean = 0;
+			size_t remaining = 0;
+			for ( size_t t = 0; t < T; ++t ) {
+				real_t value = normal( RNG );
+				if ( dataType == "flat" ) {
+					if ( remaining == 0 ) {
+						mean = 10 * normal( RNG );
+						remaining = length( RNG );
+					}
+					remaining--;
+					value = mean + 0.01 * value;
+				}
+				builder.add( &value );
+			}
+			vector<real_t> weights;
+			vector<SufficientStatistics<Normal>> stats;
+			builder.moveTo( weights, stats );
+			HaarBreakpointWeights( weights );
+
+			const CappedArrays capped( weights );
+			const InterleavedRecords records( weights, capped.pointers() );
+			vector<real_t> sorted( weights.begin() + 1, weights.end() );
+			vector<real_t> input( weights );
+			Blocks<BreakpointArray> blocks( input );
+
+			cout << dataType << " data, " << T << " positions" << endl;
+			cout << "boundaries\tblocks\tcapped [ms]\trecords [ms]\tfar pointers [ms]\tspeedup" << endl;
+			for ( const double fraction : {1e-1, 1e-2, 1e-3, 1e-4} ) {
+				// the threshold for which the given fraction of weights are at least as large
+				const size_t k = min( sorted.size() - 1, ( size_t )( fraction * sorted.size() ) );
+				nth_element( sorted.begin(), sorted.begin() + k, sorted.end(), []( real_t a, real_t b ) {
+					return a > b;
+				} );
+				const real_t threshold = sorted[k];
+
+				const size_t nrBlocks = countBlocks( blocks, threshold );
+				if ( capped.countBlocks( threshold ) != nrBlocks || records.countBlocks( threshold ) != nrBlocks ) {
+					throw runtime_error( "Layouts yield different numbers of blocks!" );
+				}
+				size_t sink = 0;
+				const double cappedTime = timePerRun( [&]() {
+					sink += capped.countBlocks( threshold );
+				}, minSeconds );
+				const double recordTime = timePerRun( [&]() {
+					sink += records.countBlocks( threshold );
+				}, minSeconds );
+				const double farTime = timePerRun( [&]() {
+					sink += countBlocks( blocks, threshold );
+				}, minSeconds );
+				cout << fraction << "\t" << nrBlocks << "\t" << 1000 * cappedTime << "\t" << 1000 * recordTime << "\t" << 1000 * farTime << "\t" << cappedTime / farTime << ( sink == 0 ? "!" : "" ) << endl;
+			}
+			cout << endl;
+		}
+		return 0;
+
+	} catch ( exception& e ) {
+		cerr << "[ERROR] " << e.what() << endl;
+		return 1;
+	}
+}
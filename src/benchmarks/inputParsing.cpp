@@ -0,0 +1,99 @@
+// Compare the throughput of reading input data through istream extraction and through the memory-mapped parser, both feeding MaxletTransform.
+
+#include "../includes.hpp"
+#include "../SufficientStatistics.hpp"
+#include "../Reader.hpp"
+#include "../MappedFile.hpp"
+#include "../wavelet.hpp"
+#include "../utils.hpp"
+#include "../Parser.hpp"
+
+#include <chrono>
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+#include <random>
+using std::mt19937;
+using std::normal_distribution;
+
+#include <cstdio>
+
+
+// wall-clock seconds since <start>
+double secondsSince( const steady_clock::time_point& start ) {
+	return duration<double>( steady_clock::now() - start ).count();
+}
+
+
+int main( int argc, const char* argv[] ) {
+
+	try {
+		Parser args( argc, argv );
+		args.registerFlags( {"-n", "-lines"}, "100000000" );
+		args.registerFlags( {"-f", "-file"}, "hammlet-benchmark-input.csv" );
+		args.registerFlags( {"-k", "-keep"} );	// keep the generated file
+		args.registerFlags( {"-h", "--help", "-help"} );
+		args.parseArgs();
+
+		if ( args.isSet( "-h" ) ) {
+			cout << "Writes a file (-f) with a given number of lines (-n, default 10^8) of normally distributed values, and reports the time MaxletTransform takes to read it using istream extraction (including the line count for reserving memory) and using the memory-mapped parser. The file is deleted afterwards, unless -k is set." << endl;
+			return 0;
+		}
+
+		const size_t nrLines = args.parse<size_t>( "-n" );
+		const string filename = args.parse<string>( "-f" );
+
+		cout << "Writing " << nrLines << " lines to " << filename << endl << flush;
+		{
+			mt19937 RNG( 0 );
+			normal_distribution<real_t> normal( 0, 1 );
+			FILE* out = fopen( filename.c_str(), "w" );
+			if ( out == nullptr ) {
+				throw runtime_error( "Cannot write to file " + filename + "!" );
+			}
+			for ( size_t i = 0; i < nrLines; ++i ) {
+				fprintf( out, "%.4f\n", normal( RNG ) );
+			}
+			fclose( out );
+		}
+
+		vector<real_t> streamCoeffs;
+		vector<SufficientStatistics<Normal>> streamStats;
+		auto start = steady_clock::now();
+		{
+			ifstream fin( filename );
+			MaxletTransform( fin, streamCoeffs, streamStats, 1, nrLinesInFile( fin ) + 1 );
+		}
+		const double streamTime = secondsSince( start );
+		cout << "istream:       " << streamTime << " s" << endl << flush;
+
+		vector<real_t> mappedCoeffs;
+		vector<SufficientStatistics<Normal>> mappedStats;
+		start = steady_clock::now();
+		{
+			MappedFile file( filename );
+			MappedTextReader reader( file );
+			MaxletTransform( reader, mappedCoeffs, mappedStats, 1, reader.sizeHint() );
+		}
+		const double mappedTime = secondsSince( start );
+		cout << "memory-mapped: " << mappedTime << " s (speedup " << streamTime / mappedTime << ")" << endl;
+
+		if ( streamCoeffs != mappedCoeffs ) {
+			throw runtime_error( "Coefficients differ between input methods!" );
+		}
+		for ( size_t i = 0; i < streamStats.size(); ++i ) {
+			if ( streamStats[i].sum() != mappedStats[i].sum() ) {
+				throw runtime_error( "Statistics differ between input methods at position " + to_string( i ) + "!" );
+			}
+		}
+
+		if ( !args.isSet( "-k" ) ) {
+			remove( filename.c_str() );
+		}
+		return 0;
+
+	} catch ( exception& e ) {
+		cerr << "[ERROR] " << e.what() << endl;
+		return 1;
+	}
+}
@@ -0,0 +1,154 @@
+// Compare the accuracy and speed of block statistics from Statistics<IntegralArray>, which sums single-precision cumulative sums over every cell a block crosses with Kahan summation, and Statistics<PrefixSum>, which subtracts two double-precision prefix sums.
+
+#include "../includes.hpp"
+#include "../Tags.hpp"
+#include "../HMM.hpp"
+#include "../Emissions.hpp"
+#include "../Blocks.hpp"
+#include "../Statistics.hpp"
+#include "../SufficientStatistics.hpp"
+#include "../utils.hpp"
+#include "../Parser.hpp"
+
+#include <chrono>
+using std::chrono::steady_clock;
+using std::chrono::duration;
+
+#include <random>
+using std::mt19937;
+using std::normal_distribution;
+
+
+// wall-clock seconds since <start>
+double secondsSince( const steady_clock::time_point& start ) {
+	return duration<double>( steady_clock::now() - start ).count();
+}
+
+
+// Errors of block statistics relative to sums in long double, normalized by the sum of absolute values and the sum of squares of each block, respectively.
+struct BlockErrors {
+	double sum = 0;
+	double sumSq = 0;
+
+	void update(
+	    const SufficientStatistics<Normal>& stats,
+	    const long double sum,
+	    const long double absSum,
+	    const long double sumSq ) {
+		if ( absSum > 0 ) {
+			this->sum = max( this->sum, ( double )( abs( stats.sum() - sum ) / absSum ) );
+		}
+		if ( sumSq > 0 ) {
+			this->sumSq = max( this->sumSq, ( double )( abs( stats.sumSq() - sumSq ) / sumSq ) );
+		}
+	}
+};
+
+
+// set the statistics of all blocks in <blocks> <nrPasses> times, and return the seconds per block
+template<typename S>
+double timePerBlock(
+    S& stats,
+    Blocks<Fixed>& blocks,
+    const size_t nrPasses ) {
+	real_t sink = 0;
+	const auto start = steady_clock::now();
+	for ( size_t p = 0; p < nrPasses; ++p ) {
+		blocks.initForward();
+		while ( blocks.next() ) {
+			stats.setStats( blocks );
+			sink += stats.suffStat( 0 ).sum();
+		}
+	}
+	const double seconds = secondsSince( start );
+	if ( sink == 12345 ) {
+		cout << "";	// prevent the loop from being optimized away
+	}
+	return seconds / ( nrPasses * blocks.nrBlocks() );
+}
+
+
+int main( int argc, const char* argv[] ) {
+
+	try {
+		Parser args( argc, argv );
+		args.registerFlags( {"-n", "-size"}, "16777216" );
+		args.registerFlags( {"-m", "-mean"}, "100" );
+		args.registerFlags( {"-t", "-time"}, "0.5" );
+		args.registerFlags( {"-h", "--help", "-help"} );
+		args.parseArgs();
+
+		if ( args.isSet( "-h" ) ) {
+			cout << "Generates normally distributed data with a given number of positions (-n, default 2^24) and mean (-m, default 100, like read depths), and reports for blocks of size 1, 100, 10^4 and 10^6 covering the input the maximum error of the block statistics of Statistics<IntegralArray> and Statistics<PrefixSum> relative to long double sums, as well as the time per block. Each pass over the blocks is repeated for at least -t seconds (default 0.5)." << endl;
+			return 0;
+		}
+
+		const size_t T = args.parse<size_t>( "-n" );
+		const real_t mean = args.parse<real_t>( "-m" );
+		const double minSeconds = args.parse<double>( "-t" );
+
+		mt19937 RNG( 0 );
+		normal_distribution<real_t> normal( mean, 1 );
+		vector<real_t> values( T );
+		for ( auto & x : values ) {
+			x = normal( RNG );
+		}
+
+		auto start = steady_clock::now();
+		vector<SufficientStatistics<Normal>> input( values.begin(), values.end() );
+		Statistics<IntegralArray, Normal> integral( input, 1 );
+		const double integralSetup = secondsSince( start );
+
+		start = steady_clock::now();
+		input.assign( values.begin(), values.end() );
+		Statistics<PrefixSum, Normal> prefix( input, 1 );
+		const double prefixSetup = secondsSince( start );
+
+		cout << T << " positions with mean " << mean << ", construction: integral array " << 1000 * integralSetup << " ms, prefix sums " << 1000 * prefixSetup << " ms" << endl;
+		cout << "block size\tblocks\tintegral sum error\tintegral sumSq error\tprefix sum error\tprefix sumSq error\tintegral [ns/block]\tprefix [ns/block]\tspeedup" << endl;
+		for ( const size_t blockSize : {( size_t )1, ( size_t )100, ( size_t )10000, ( size_t )1000000} ) {
+			if ( blockSize > T ) {
+				continue;
+			}
+			vector<size_t> sizes( T / blockSize, blockSize );
+			if ( T % blockSize > 0 ) {
+				sizes.push_back( T % blockSize );
+			}
+			Blocks<Fixed> blocks( sizes );
+
+			// errors against sums in long double
+			BlockErrors integralErrors;
+			BlockErrors prefixErrors;
+			blocks.initForward();
+			while ( blocks.next() ) {
+				long double sum = 0;
+				long double absSum = 0;
+				long double sumSq = 0;
+				for ( size_t t = blocks.start(); t < blocks.end(); ++t ) {
+					const SufficientStatistics<Normal> x( values[t] );
+					sum += x.sum();
+					absSum += abs( x.sum() );
+					sumSq += x.sumSq();
+				}
+				integral.setStats( blocks );
+				integralErrors.update( integral.suffStat( 0 ), sum, absSum, sumSq );
+				prefix.setStats( blocks );
+				prefixErrors.update( prefix.suffStat( 0 ), sum, absSum, sumSq );
+			}
+
+			// repeat passes for at least minSeconds, estimated from a single pass
+			start = steady_clock::now();
+			timePerBlock( integral, blocks, 1 );
+			const size_t nrPasses = max( ( size_t )1, ( size_t )( minSeconds / max( secondsSince( start ), 1e-9 ) ) );
+			const double integralTime = timePerBlock( integral, blocks, nrPasses );
+			const double prefixTime = timePerBlock( prefix, blocks, nrPasses );
+
+			cout << blockSize << "\t" << blocks.nrBlocks() << "\t" << integralErrors.sum << "\t" << integralErrors.sumSq << "\t" << prefixErrors.sum << "\t" << prefixErrors.sumSq << "\t" << 1e9 * integralTime << "\t" << 1e9 * prefixTime << "\t" << integralTime / prefixTime << endl;
+		}
+		return 0;
+
+	} catch ( exception& e ) {
+		cerr << "[ERROR] " << e.what() << endl;
+		return 1;
+	}
+}
@@ -42,6 +42,7 @@ using std::to_string;
 #include <sstream>
 using std::stringstream;
 using std::istringstream;
+using std::ostringstream;
 
 
 #include <iostream>
@@ -80,6 +81,7 @@ using std::floor;
 using std::abs;
 
 using std::isfinite;
+using std::isnan;
 
 
 
@@ -111,7 +113,11 @@ using std::unordered_map;
 using std::stack;
 
 
-#include <climits>
+#include <memory>
+using std::unique_ptr;
+
+
+#include <limits>
 using std::numeric_limits;
 
 
@@ -8,6 +8,8 @@
 #include "AutoPriors.hpp"
 #include "Records.hpp"
 #include "wavelet.hpp"
+#include "Reader.hpp"
+#include "MappedFile.hpp"
 #include "StateSequence.hpp"
 #include "Statistics.hpp"
 #include "includes.hpp"
@@ -15,7 +17,320 @@
 #include "utils.hpp"
 
 
-// TODO generalize static sampling by setting minimum and maximum threshold to avoid huge trellis as well as bias through overcompression?
+// Read the segment sizes from the first column of a file such as the output of maxSegmentation, skipping empty segments.
+vector<size_t> readSegmentSizes( const string& filename ) {
+	ifstream file( filename.c_str() );
+	if ( !file.is_open() ) {
+		throw runtime_error( "Cannot read file " + filename + "!" );
+	}
+	vector<size_t> sizes;
+	string line;
+	size_t lineNr = 0;
+	while ( getline( file, line ) ) {
+		lineNr++;
+		if ( line.find_first_not_of( " \t\r" ) == string::npos ) {
+			continue;
+		}
+		istringstream fields( line );
+		long long size;
+		if ( !( fields >> size ) || size < 0 ) {
+			throw runtime_error( "Invalid segment size in line " + to_string( lineNr ) + " of " + filename + "!" );
+		}
+		if ( size > 0 ) {
+			sizes.push_back( size );
+		}
+	}
+	return sizes;
+}
+
+
+
+
+// Sampling type R of -i is rejected during argument validation unless adaptive blocks (-y A) are used, so other block structures never get here. This overload only exists so that the sampler compiles for them.
+template<typename S, typename B, typename... Args>
+void refineBlocks(
+    Emissions<S, B>&,
+    Args& ... ) {
+}
+
+
+// In each of up to <rounds> rounds, sample <iterations> FBG iterations on the current blocks without recording, and split the blocks that are either uncertain or inhomogeneous over the second half of the iterations. A block is uncertain if its most frequent state has a frequency below the confidence given to -y A, and inhomogeneous if in most iterations its strongest interior breakpoint weight exceeds the threshold that dynamic compression would use for the variance of its state. Stop early once no block is split.
+template<typename S>
+void refineBlocks(
+    Emissions<S, Blocks<Splittable>>& y,
+    Parser& args,
+    Theta<NormalInverseGamma>& theta,
+    ThetaHyperParam<NormalInverseGammaParam>& tau_theta,
+    Transitions<DirichletVector>& A,
+    TransitionHyperParam<DirichletParamVector>& tau_A,
+    Initial<Dirichlet>& pi,
+    InitialHyperParam<DirichletParam>& tau_pi,
+    const Mapping& mapping,
+    Records& records,
+    const size_t iterations,
+    const size_t rounds,
+    const bool useSelfTrans,
+    const bool verbose,
+    rng_t& RNG ) {
+
+	const real_t confidence = ( args.nrTokens( "-y" ) > 1 ? args.parse<real_t>( "-y", 1 ) : 0.95 );
+	const size_t nrStates = mapping.nrStates();
+	const real_t logFactor = 2 * log( ( real_t ) y.size() );
+	StateSequence< ForwardBackward > q( RNG );
+	vector<real_t> stateThresholds( nrStates );
+	for ( size_t round = 0; round < rounds; ++round ) {
+		y.createBlocks( y.blocks().threshold() );	// materialize the blocks of the previous round
+		const size_t nrBlocks = y.nrBlocks();
+		const vector<real_t> splitWeights = y.blocks().splitWeights();
+		vector<size_t> counts( nrBlocks * nrStates, 0 );
+		vector<size_t> inhomogeneous( nrBlocks, 0 );
+		size_t nrCounted = 0;
+		for ( size_t i = 0; i < iterations; ++i ) {
+			sampleHMM( y, q, theta, tau_theta, A, tau_A, pi, tau_pi, mapping, 1, 0, records, false, useSelfTrans );
+			if ( 2 * i >= iterations ) {
+				// the dynamic threshold for the smallest variance of each state
+				for ( size_t s = 0; s < nrStates; ++s ) {
+					real_t var = inf;
+					for ( const auto p : theta.mapping( s ) ) {
+						var = min( var, theta.value()[p].var() );
+					}
+					stateThresholds[s] = sqrt( logFactor * var );
+				}
+				const vector<marginal_t>& states = q.states();
+				for ( size_t b = 0; b < nrBlocks; ++b ) {
+					counts[b * nrStates + states[b]]++;
+					if ( splitWeights[b] >= stateThresholds[states[b]] ) {
+						inhomogeneous[b]++;
+					}
+				}
+				nrCounted++;
+			}
+		}
+
+		vector<bool> selected( nrBlocks );
+		for ( size_t b = 0; b < nrBlocks; ++b ) {
+			const size_t maxCount = *max_element( counts.begin() + b * nrStates, counts.begin() + ( b + 1 ) * nrStates );
+			selected[b] = ( maxCount < confidence * nrCounted || 2 * inhomogeneous[b] > nrCounted );
+		}
+		const size_t nrSplits = y.blocks().split( selected );
+		if ( verbose ) {
+			cout << "Refinement round " << round + 1 << ": split " << nrSplits << " of " << nrBlocks << " blocks" << endl << flush;
+		}
+		if ( nrSplits == 0 ) {
+			break;
+		}
+	}
+	y.createBlocks( y.blocks().threshold() );
+}
+
+
+
+
+// Run the sampling scheme given by -i on the emissions <y>, which can use any combination of statistics and block data structures.
+template<typename S, typename B>
+void runSampler(
+    Emissions<S, B>& y,
+    Parser& args,
+    vector<vector<real_t>>& thetaParams,
+    const real_t stdEstimate,
+    const size_t nrDataDim,
+    const MappingType mappingType,
+    Mapping& mapping,
+    Transitions<DirichletVector>& A,
+    TransitionHyperParam<DirichletParamVector>& tau_A,
+    Initial<Dirichlet>& pi,
+    InitialHyperParam<DirichletParam>& tau_pi,
+    Records& records,
+    const bool useSelfTrans,
+    const bool verbose,
+    rng_t& RNG ) {
+
+	// limit block sizes and the number of blocks before any blocks are created
+	if ( args.isSet( "-b" ) ) {
+		if ( args.nrTokens( "-b" ) != 2 ) {
+			throw runtime_error( "-b requires a minimum and a maximum block size!" );
+		}
+		y.blocks().setBlockLimits( args.parse<size_t>( "-b", 0 ), args.parse<size_t>( "-b", 1 ) );
+	}
+	if ( args.isSet( "-r" ) ) {
+		if ( args.nrTokens( "-r" ) != 1 ) {
+			throw runtime_error( "-r requires a maximum number of blocks!" );
+		}
+		y.setMaxBlocks( args.parse<size_t>( "-r" ) );
+		if ( verbose ) {
+			cout << "Minimum threshold for at most " << args.parse<size_t>( "-r" ) << " blocks: " << y.minThreshold() << endl << flush;
+		}
+	}
+
+	// TODO this version calculates the same autopriors for all dimensions, adapt for flexible mapping
+	thetaParams[0] = autoPrior( thetaParams[0][0], thetaParams[0][1], y, stdEstimate );
+	
+	for ( auto & param : thetaParams ) {
+		param = thetaParams[0];
+	}
+
+	ThetaHyperParam<NormalInverseGammaParam> tau_theta(
+	    thetaParams );
+
+	// cache block structures for a grid of thresholds, default parameters are used if -k is given without arguments
+	if ( args.isSet( "-k" ) ) {
+		const real_t cellWidth = ( args.nrTokens( "-k" ) > 0 ? args.parse<real_t>( "-k", 0 ) : 0.05 );
+		const size_t megabytes = ( args.nrTokens( "-k" ) > 1 ? args.parse<size_t>( "-k", 1 ) : 1024 );
+		y.setBlockCache( cellWidth, megabytes << 20 );
+	}
+
+	// freeze dynamic block structures once they stop changing, default parameters are used if -u is given without arguments
+	if ( args.isSet( "-u" ) ) {
+		const size_t iterations = ( args.nrTokens( "-u" ) > 0 ? args.parse<size_t>( "-u", 0 ) : 20 );
+		const real_t tolerance = ( args.nrTokens( "-u" ) > 1 ? args.parse<real_t>( "-u", 1 ) : 0.01 );
+		y.setAutoStatic( iterations, tolerance );
+	}
+
+	Theta<NormalInverseGamma> theta(
+	    tau_theta,
+	    nrDataDim,
+	    mappingType,
+	    RNG	// TODO pass to sampler instead of making it a member?
+	);
+
+
+
+
+	// TODO run a general check on the tokens to avoid running the sampler if there are parsing errors
+	size_t nrTokens = 0;
+	for ( auto c : args.tokens( "-i" ) ) {
+		if ( c != "P" && c != "S" && c != "D" ) {
+			nrTokens++;
+		}
+	}
+	// check that iterations are grouped in triples
+	if ( nrTokens % 3 != 0 ) {
+		throw runtime_error( "Parameters for -i, excluding \"P\", \"S\" and \"D\", must be multiples of 3!" );
+	}
+	nrTokens = args.nrTokens( "-i" );
+
+
+	// get iteration types
+	bool samplePrior = true;
+	bool dynamic = true;
+	if ( verbose ) {
+		cout << "Setting block structure to dynamic" << endl << flush;
+	}
+	string method;
+	size_t iterations, thinning;
+	for ( size_t i = 0; i < nrTokens; ) {
+		string method = args.parse<string> ( "-i", i );	// G=direct gibbs, M=mixture, F = forward-backward gibbs
+		if ( samplePrior ) {
+			if ( verbose ) {
+				cout << "Sampling prior" << endl << flush;
+			}
+			theta.sample( tau_theta );
+			pi.sample( tau_pi );
+			A.sample( tau_A );
+			samplePrior = false;
+		}
+
+		if ( method == "P" ) {
+			samplePrior = true;
+			i ++;
+			continue;
+		}  else if ( method == "S" ) {
+			if ( verbose ) {
+				cout << "Setting block structure to static" << endl << flush;
+			}
+			y.unfreeze();
+			y.createBlocks( theta );
+			dynamic = false;
+			i ++;
+			continue;
+		} else if ( method == "D" ) {
+			if ( verbose ) {
+				cout << "Setting block structure to dynamic" << endl << flush;
+			}
+			y.unfreeze();
+			dynamic = true;
+			i ++;
+			continue;
+		} else {
+			if ( i + 2 >= nrTokens ) {
+				throw runtime_error( "Incomplete command line for -i!" );
+			}
+			iterations = args.parse<size_t> ( "-i", i + 1 );
+			thinning = args.parse<size_t> ( "-i", i + 2 );
+			i += 3;
+		}
+		const bool wasFrozen = y.frozen();
+
+
+		if ( method == "F" ) {
+			if ( verbose ) {
+				// TODO more detailed output
+				cout << "Sampling Forward-Backward" << endl << flush;
+			}
+			StateSequence< ForwardBackward > q( RNG );
+			sampleHMM( y, q, theta, tau_theta, A, tau_A, pi, tau_pi,  mapping, iterations, thinning, records, dynamic, useSelfTrans );
+
+		} else if ( method == "R" ) {	// coarse-to-fine refinement, the third token is the maximum number of rounds
+			if ( verbose ) {
+				cout << "Refining blocks" << endl << flush;
+			}
+			refineBlocks( y, args, theta, tau_theta, A, tau_A, pi, tau_pi, mapping, records, iterations, thinning, useSelfTrans, verbose, RNG );
+
+		} else if ( method == "M" ) {	// Mixture sampling
+			if ( verbose ) {
+				cout << "Sampling mixture" << endl << flush;
+			}
+			StateSequence< Mixture > q( RNG );
+			sampleHMM( y, q, theta, tau_theta, A, tau_A, pi, tau_pi,  mapping, iterations, thinning, records, dynamic, useSelfTrans );
+
+			/*} else if ( method == "G" ) {	// Direct Gibbs sampling
+				StateSequence< DirectGibbs > q( RNG );
+				sampleHMM( y, tau_theta, theta, tau_A, A, tau_pi, pi, q, mapping, iterations, thinning, records, i == 0, useSelfTrans );*/
+
+		} else {
+			throw runtime_error( "Unknown sampling type " + method + "!" );
+		}
+
+		if ( verbose && dynamic && !wasFrozen && y.frozen() ) {
+			cout << "Block structure has stopped changing, setting it to static" << endl << flush;
+		}
+		if ( verbose && y.hasBlockCache() ) {
+			const size_t lookups = y.cacheHits() + y.cacheMisses();
+			cout << "Block cache: " << y.cacheHits() << " hits, " << y.cacheMisses() << " misses (" << ( lookups > 0 ? 100.0 * y.cacheHits() / lookups : 0.0 ) << "% hit rate)" << endl << flush;
+		}
+	}
+	samplePrior = false;
+}
+
+
+
+
+// Run the sampler on <blocks>, with their statistics stored as prefix sums in double precision or exact integers if <prefixSums> is "double" or "integer", or in an integral array otherwise. The remaining arguments are passed on to runSampler().
+template<typename B, typename... SamplerArgs>
+void runOnStatistics(
+    const string& prefixSums,
+    vector<SufficientStatistics<Normal>>& stats,
+    const size_t nrDataDim,
+    const size_t nrThreads,
+    Blocks<B>& blocks,
+    SamplerArgs&& ... samplerArgs ) {
+	if ( prefixSums == "integer" ) {
+		typedef Statistics<IntegerPrefixSum, Normal> S;
+		S ps( stats, nrDataDim, nrThreads );
+		Emissions<S, Blocks<B>> y( ps, blocks );
+		runSampler( y, std::forward<SamplerArgs>( samplerArgs )... );
+	} else if ( prefixSums == "double" ) {
+		typedef Statistics<PrefixSum, Normal> S;
+		S ps( stats, nrDataDim, nrThreads );
+		Emissions<S, Blocks<B>> y( ps, blocks );
+		runSampler( y, std::forward<SamplerArgs>( samplerArgs )... );
+	} else {
+		typedef Statistics<IntegralArray, Normal> S;
+		S ia( stats, nrDataDim, nrThreads );
+		Emissions<S, Blocks<B>> y( ia, blocks );
+		runSampler( y, std::forward<SamplerArgs>( samplerArgs )... );
+	}
+}
 
 
 
@@ -33,11 +348,13 @@ int main( int argc, const char* argv[] ) {
 		args.registerFlags( {"-v", "-verbose"} );
 		args.registerFlags( {"-g", "-arguments"} );
 		args.registerFlags( {"-h", "-help" , "--help"} );	// we leave --help an undocumented convenience
+		args.registerFlags( {"-j", "-threads"}, "1" );
 
 
 		// I/O
 // 		args.registerFlags( {"-c", "-pipe"} );
 		args.registerFlags( {"-f", "-input-file"} );
+		args.registerFlags( {"-F", "-input-format"}, "auto" );
 		args.registerFlags( {"-o", "-output-pattern"}, "hammlet- .csv" );	// NOTE if -f is provided and -o is not, the input file name is used instead
 		args.registerFlags( {"-O", "-output-data"}, "marginals" );
 		args.registerFlags( {"-w", "-overwrite"} );
@@ -58,8 +375,13 @@ int main( int argc, const char* argv[] ) {
 
 
 		// COMPRESSION
-// 		args.registerFlags( {"-y", "-data-structure"}, "B" );	// TODO provide alternative data structures
-// 		args.registerFlags( {"-b", "-block-limits"}, "0 0" );
+		args.registerFlags( {"-y", "-data-structure"}, "B" );
+		args.registerFlags( {"-x", "-weight-index"} );
+		args.registerFlags( {"-k", "-block-cache"}, "0.05 1024" );
+		args.registerFlags( {"-u", "-auto-static"}, "20 0.01" );
+		args.registerFlags( {"-b", "-block-limits"}, "1 0" );
+		args.registerFlags( {"-r", "-max-blocks"} );
+		args.registerFlags( {"-p", "-prefix-sums"} );
 		args.registerFlags( {"-m", "-weight-multiplier"}, "1" );	// multiply weights by this factor, to avoid overcompression
 
 		args.parseArgs();
@@ -73,6 +395,12 @@ int main( int argc, const char* argv[] ) {
 		// Set verbosity
 		const bool verbose = args.isSet( "-v" );
 
+		// Number of threads for parallelizable work such as decompressing input
+		const size_t nrThreads = args.parse<size_t>( "-j", 0 );
+		if ( nrThreads == 0 ) {
+			throw runtime_error( "Number of threads must be positive!" );
+		}
+
 		// Allow to overwrite existing files?
 		const bool overwrite = args.isSet( "-w" );
 
@@ -92,8 +420,13 @@ int main( int argc, const char* argv[] ) {
 		if ( ( !args.isSet( "-o" ) ) && args.isSet( "-f" ) ) {
 			string filename = args.parse<string>( "-f" );
 			size_t i = filename.find_last_of( "." );
-			opref = filename.substr( 0, i ) + "-";
-			osuff = filename.substr( i );
+			if ( i == string::npos || filename.find( "/", i ) != string::npos ) {	// no extension, e.g. for count prefixes
+				opref = filename + "-";
+				osuff = ".csv";
+			} else {
+				opref = filename.substr( 0, i ) + "-";
+				osuff = filename.substr( i );
+			}
 		} else {
 			opref = args.parse<string> ( "-o", 0 );
 			osuff = args.parse<string> ( "-o", 1 );
@@ -172,24 +505,56 @@ int main( int argc, const char* argv[] ) {
 // 		const size_t chunkSize = max( ( size_t ) 1, args.parse<size_t> ( "-b", 0 ) );
 // 		const size_t maxBlockSize = args.parse<size_t> ( "-b", 1 );
 
-		const string dataStructure = "B";
-		if ( dataStructure == "B" ||  dataStructure == "breakpointarray" ) {
-			// TODO any parameters to breakpoint array would go here
-
-
-
-
-// 		} else
-// 				if ( dataStructure == "wavelettree" ) {
-
-			// TODO parameters to wavelet tree
-// 			const size_t nrSkipLevels = args.parse<size_t>( "-w", 0, 0 );
-// 		const size_t nrAdditionalLevels = args.parse<size_t>( "-w", 1, 0 );
-// 		const bool useFullCompression = args.parse<bool>( "-w", 2, true );
-
-		} else {
+		const string dataStructure = args.parse<string>( "-y" );
+		const bool fixedBlocks = ( dataStructure == "F" || dataStructure == "fixed" );
+		const bool adaptiveBlocks = ( dataStructure == "A" || dataStructure == "adaptive" );
+		if ( dataStructure != "B" && dataStructure != "breakpointarray" && dataStructure != "W" && dataStructure != "wavelettree" && !fixedBlocks && !adaptiveBlocks ) {
 			throw runtime_error( "Unknown data structure \"" + dataStructure + "\", or not implemented yet!" );
 		}
+		if ( fixedBlocks || adaptiveBlocks ) {
+			if ( fixedBlocks && args.nrTokens( "-y" ) != 2 ) {
+				throw runtime_error( "Fixed blocks (-y F) require a file of segment sizes!" );
+			}
+			if ( adaptiveBlocks && args.nrTokens( "-y" ) > 3 ) {
+				throw runtime_error( "Adaptive blocks (-y A) take at most a confidence and a coarsening factor!" );
+			}
+			for ( const string flag : {"-x", "-k", "-b", "-r"} ) {
+				if ( args.isSet( flag ) ) {
+					throw runtime_error( "Option " + flag + " cannot be used with " + ( fixedBlocks ? "fixed blocks (-y F)" : "adaptive blocks (-y A)" ) + "!" );
+				}
+			}
+		} else if ( args.nrTokens( "-y" ) != 1 ) {
+			throw runtime_error( "Data structure \"" + dataStructure + "\" does not take arguments!" );
+		}
+		if ( !adaptiveBlocks ) {
+			const vector<string> scheme = args.tokens( "-i" );
+			for ( size_t i = 0; i < scheme.size(); i += ( scheme[i] == "P" || scheme[i] == "S" || scheme[i] == "D" ? 1 : 3 ) ) {
+				if ( scheme[i] == "R" ) {
+					throw runtime_error( "Sampling type R in -i requires adaptive blocks (-y A)!" );
+				}
+			}
+		}
+
+		// use prefix sums instead of the integral array for the statistics of blocks, in exact integers for integer data unless a type is given
+		string prefixSums = "none";
+		if ( args.isSet( "-p" ) ) {
+			if ( dataStructure == "W" || dataStructure == "wavelettree" ) {
+				throw runtime_error( "Prefix sums (-p) cannot be used with the wavelet tree (-y W)!" );
+			}
+			if ( args.nrTokens( "-p" ) > 1 ) {
+				throw runtime_error( "-p takes at most one type of prefix sums!" );
+			}
+			const string type = ( args.nrTokens( "-p" ) > 0 ? args.parse<string>( "-p" ) : "A" );
+			if ( type == "A" || type == "auto" ) {
+				prefixSums = "auto";
+			} else if ( type == "I" || type == "integer" ) {
+				prefixSums = "integer";
+			} else if ( type == "D" || type == "double" ) {
+				prefixSums = "double";
+			} else {
+				throw runtime_error( "Unknown type of prefix sums \"" + type + "\"!" );
+			}
+		}
 
 		const real_t weightMultiplier = args.parse<real_t>( "-m" );
 
@@ -243,6 +608,7 @@ int main( int argc, const char* argv[] ) {
 		outputArgs.registerFlags( {"C", "compression"} );
 		outputArgs.registerFlags( {"D", "mapping"} );	// output the emission mappings for each state
 		outputArgs.registerFlags( {"G", "segments"} );	// in each iteration: number of marginal segments, number of values used to store marginals (for diagnostics)
+		outputArgs.registerFlags( {"X", "coordinates"} );	// coordinate columns of the input, see -F
 		outputArgs.parseArgs();
 
 
@@ -252,6 +618,28 @@ int main( int argc, const char* argv[] ) {
 		}
 
 
+		// Input format, see createReader()
+		const vector<string> inputFormat = args.tokens( "-F" );
+		const bool isTextFormat = ( inputFormat.size() == 0 || inputFormat[0] == "auto" || inputFormat[0] == "text" );	// formats that can also be read from a stream
+
+
+		// coordinate columns are copied to their own file while the input is read
+		ofstream coordinateFile;
+		if ( outputArgs.isSet( "coordinates" ) ) {
+			if ( isTextFormat || ( inputFormat[0] != "tsv" && inputFormat[0] != "csv" && inputFormat[0] != "bed" ) ) {
+				throw runtime_error( "Output of coordinates requires input format tsv, csv or bed!" );
+			}
+			const string filename = outputPrefix + "coordinates" + outputSuffix;
+			if ( fileExists( filename ) && !overwrite ) {
+				throw runtime_error( "File " + filename + " already exists! Use -w to allow overwrite!" );
+			}
+			coordinateFile.open( filename.c_str() );
+			if ( !coordinateFile.is_open() ) {
+				throw runtime_error( "Cannot write to file " + filename + "!" );
+			}
+		}
+
+
 		// inputValues holds things like breakpoint weights, depending on the data structure being used
 		vector<real_t> inputValues;
 
@@ -263,29 +651,115 @@ int main( int argc, const char* argv[] ) {
 			// create sufficient statistics for input data
 			vector<SufficientStatistics<Normal>> stats;
 
-			// TODO right now, individual files are concatenated. We should also allow multiple files to contain multiple dimensions.
-			if ( args.isSet( "-f" ) ) { // read from input files
-				for ( string fname : args.parseVector<string>( "-f" ) ) {	// iterate over input file names
+			// genome coordinates of the data positions, for count input
+			GenomeMap genomeMap;
+
+			if ( args.isSet( "-f" ) && inputFormat.size() > 0 && inputFormat[0] == "counts" ) {	// read size, pos and count files written by samToCounts
+				const vector<string> prefixes = args.parseVector<string>( "-f" );
+				if ( prefixes.size() != 1 ) {
+					throw runtime_error( "Input format counts requires exactly one file prefix!" );
+				}
+				if ( nrDataDim != 1 ) {
+					throw runtime_error( "Input format counts is univariate, but the model has " + to_string( nrDataDim ) + " dimensions!" );
+				}
+				const string gaps = ( inputFormat.size() > 1 ? inputFormat[1] : "zeros" );
+				if ( gaps != "zeros" && gaps != "breaks" ) {
+					throw runtime_error( "Unknown gap mode " + gaps + " for input format counts, use zeros or breaks!" );
+				}
+				if ( verbose ) {
+					cout << "Reading counts from " + prefixes[0] + "-size.csv, " + prefixes[0] + "-pos.csv.gz and " + prefixes[0] + "-count.csv.gz" << endl << flush;
+				}
+				unique_ptr<Reader> reader = pipelineReader( unique_ptr<Reader>( new CountsReader( prefixes[0], gaps == "zeros", &genomeMap ) ), nrThreads );
+				MaxletTransform( *reader, inputValues, stats, nrDataDim, 0, nrThreads );
+
+			} else if ( inputFormat.size() > 0 && inputFormat[0] == "rle" ) {	// run-length encoded text from a file or STDIN
+				unique_ptr<MappedFile> mappedFile;
+				if ( args.isSet( "-f" ) ) {
+					const vector<string> filenames = args.parseVector<string>( "-f" );
+					if ( filenames.size() != 1 ) {
+						throw runtime_error( "Input format rle requires exactly one input file!" );
+					}
+					mappedFile = unique_ptr<MappedFile>( new MappedFile( filenames[0] ) );
+				}
+				if ( verbose ) {
+					cout << "Reading run-length encoded input from " + ( args.isSet( "-f" ) ? args.parse<string>( "-f" ) : string( "standard input" ) ) << endl << flush;
+				}
+
+				// run-length encoding is compact, so input that cannot be memory-mapped (STDIN or named pipes) is read into memory as a whole
+				string buffer;
+				unique_ptr<RunLengthReader> reader;
+				if ( mappedFile && mappedFile->isOpen() ) {
+					reader = unique_ptr<RunLengthReader>( new RunLengthReader( *mappedFile, nrDataDim ) );
+				} else {
+					ifstream fin;
+					if ( mappedFile ) {
+						fin.open( args.parse<string>( "-f" ) );
+						if ( !fin ) {
+							throw runtime_error( "Cannot read from input file " + args.parse<string>( "-f" ) + "!" );
+						}
+					}
+					stringstream content;
+					content << ( mappedFile ? fin : cin ).rdbuf();
+					buffer = content.str();
+					reader = unique_ptr<RunLengthReader>( new RunLengthReader( buffer.data(), buffer.data() + buffer.size(), nrDataDim ) );
+				}
+				MaxletTransform( *reader, inputValues, stats, nrDataDim );
+
+			} else if ( args.isSet( "-f" ) ) { // read from input files
+				const vector<string> filenames = args.parseVector<string>( "-f" );
+
+				// Files and streams need to outlive the readers. Multiple files are read in lockstep, each providing the next dimension(s) of every position.
+				vector<unique_ptr<MappedFile>> mappedFiles;
+				vector<unique_ptr<ifstream>> streams;
+				vector<unique_ptr<Reader>> readers;
+				const size_t fileDim = ( filenames.size() > 1 ? 1 : nrDataDim );	// number of dimensions of files that do not specify it, e.g. text
+				size_t nrReaderDim = 0;
+				for ( string fname : filenames ) {	// iterate over input file names
 					if ( verbose ) {
 						cout << "Reading " + fname + "" << endl << flush;
 					}
-					ifstream fin( fname );
-
-					if ( fin ) {
-						// TODO this can still lead to reallocation, fix later
-						// TODO MaxletTransform does not work for multiple files in its current state
-						MaxletTransform( fin, inputValues, stats, nrDataDim, inputValues.size() + nrLinesInFile( fin ) + 1 );
-						// NOTE Reserving +1 is really important here! In the integral array, an element is appended to stats, and not reserving space for that element can lead to reallocations in the gigabyte range!
-
+					// memory-map regular files and parse them directly, fall back to streaming for named pipes etc., which MappedFile leaves unopened
+					mappedFiles.push_back( unique_ptr<MappedFile>( new MappedFile( fname ) ) );
+					if ( mappedFiles.back()->isOpen() ) {
+						readers.push_back( createReader( *mappedFiles.back(), inputFormat, fileDim, nrThreads, ( coordinateFile.is_open() && readers.size() == 0 ? &coordinateFile : nullptr ) ) );
 					} else {
-						throw runtime_error( "Cannot read from input file " + fname + "!" );
+						if ( !isTextFormat ) {
+							throw runtime_error( "Input format " + inputFormat[0] + " requires a regular file, cannot map " + fname + "!" );
+						}
+						streams.push_back( unique_ptr<ifstream>( new ifstream( fname ) ) );
+						if ( !*streams.back() ) {
+							throw runtime_error( "Cannot read from input file " + fname + "!" );
+						}
+						readers.push_back( unique_ptr<Reader>( new StreamReader( *streams.back() ) ) );
+					}
+					nrReaderDim += ( readers.back()->nrDim() > 0 ? readers.back()->nrDim() : fileDim );
+				}
+				if ( nrReaderDim != nrDataDim ) {
+					throw runtime_error( "Input file(s) contain " + to_string( nrReaderDim ) + " dimensions, but the model has " + to_string( nrDataDim ) + "!" );
+				}
+
+				unique_ptr<Reader> reader;
+				if ( readers.size() == 1 ) {
+					reader = pipelineReader( std::move( readers[0] ), nrThreads );
+				} else if ( nrThreads > readers.size() ) {	// enough threads to parse each file on its own
+					for ( auto & r : readers ) {
+						r = pipelineReader( std::move( r ), nrThreads );
 					}
+					reader = unique_ptr<Reader>( new InterleavedReader( readers ) );
+				} else {
+					reader = pipelineReader( unique_ptr<Reader>( new InterleavedReader( readers ) ), nrThreads );
 				}
+				MaxletTransform( *reader, inputValues, stats, nrDataDim, reader->sizeHint(), nrThreads );
+
 			} else {	// read from STDIN
 				if ( verbose ) {
 					cout << "Reading from standard input" << endl << flush;
 				}
-				MaxletTransform( cin, inputValues, stats, nrDataDim );
+				if ( !isTextFormat ) {
+					throw runtime_error( "Input format " + inputFormat[0] + " requires -f!" );
+				}
+				unique_ptr<Reader> reader = pipelineReader( unique_ptr<Reader>( new StreamReader( cin ) ), nrThreads );
+				MaxletTransform( *reader, inputValues, stats, nrDataDim, 0, nrThreads );
 			}
 
 
@@ -295,6 +769,13 @@ int main( int argc, const char* argv[] ) {
 
 			const size_t T = inputValues.size();
 
+			if ( prefixSums == "auto" ) {
+				prefixSums = ( Statistics<IntegerPrefixSum, Normal>::representable( stats, nrDataDim ) ? "integer" : "double" );
+				if ( verbose ) {
+					cout << "Using " << prefixSums << " prefix sums" << endl << flush;
+				}
+			}
+
 			if ( verbose ) {
 				cout << "Number of data points: " + to_string( T ) << endl << flush;
 			}
@@ -333,126 +814,59 @@ int main( int argc, const char* argv[] ) {
 				w *= weightMultiplier;
 			}
 
-			if ( dataStructure == "B" || dataStructure == "breakpointarray" ) {
-
-				typedef Statistics<IntegralArray, Normal> S;
-				typedef Blocks<BreakpointArray> B;
-				S ia( stats, nrDataDim );
-				B waveletBlocks( inputValues );
-
-				Emissions<S, B> y( ia, waveletBlocks );
-
-
-
-				// TODO this version calculates the same autopriors for all dimensions, adapt for flexible mapping
-				thetaParams[0] = autoPrior( thetaParams[0][0], thetaParams[0][1], y, stdEstimate );
-				
-				for ( auto & param : thetaParams ) {
-					param = thetaParams[0];
+			// force breakpoints between refseqs and at gaps in count input, and report genome coordinates for each segment
+			if ( genomeMap.nrRuns() > 0 ) {
+				for ( size_t r = 1; r < genomeMap.nrRuns(); ++r ) {
+					inputValues[genomeMap.runStart( r )] = inf;
 				}
+				records.setGenomeMap( &genomeMap );
+			}
 
-				ThetaHyperParam<NormalInverseGammaParam> tau_theta(
-				    thetaParams );
-
-				Theta<NormalInverseGamma> theta(
-				    tau_theta,
-				    nrDataDim,
-				    mappingType,
-				    RNG	// TODO pass to sampler instead of making it a member?
-				);
-
-
-
-
-				// TODO run a general check on the tokens to avoid running the sampler if there are parsing errors
-				size_t nrTokens = 0;
-				for ( auto c : args.tokens( "-i" ) ) {
-					if ( c != "P" && c != "S" && c != "D" ) {
-						nrTokens++;
+			if ( dataStructure == "B" || dataStructure == "breakpointarray" ) {
+				Blocks<BreakpointArray> waveletBlocks( inputValues, nrThreads );
+				if ( args.isSet( "-x" ) ) {
+					if ( verbose ) {
+						cout << "Sorting breakpoints by weight" << endl << flush;
 					}
+					waveletBlocks.createWeightIndex();
 				}
-				// check that iterations are grouped in triples
-				if ( nrTokens % 3 != 0 ) {
-					throw runtime_error( "Parameters for -i, excluding \"P\", \"S\" and \"D\", must be multiples of 3!" );
-				}
-				nrTokens = args.nrTokens( "-i" );
+				runOnStatistics( prefixSums, stats, nrDataDim, nrThreads, waveletBlocks, args, thetaParams, stdEstimate, nrDataDim, mappingType, mapping, A, tau_A, pi, tau_pi, records, useSelfTrans, verbose, RNG );
 
+			} else if ( dataStructure == "W" || dataStructure == "wavelettree" ) {
+				if ( args.isSet( "-x" ) ) {
+					throw runtime_error( "The weight index (-x) requires the breakpoint array (-y B)!" );
+				}
+				typedef Statistics<WaveletTree, Normal> S;
+				typedef Blocks<WaveletTree> B;
+				S nodeStats( stats, nrDataDim );
+				B waveletBlocks( inputValues );
+				Emissions<S, B> y( nodeStats, waveletBlocks );
+				runSampler( y, args, thetaParams, stdEstimate, nrDataDim, mappingType, mapping, A, tau_A, pi, tau_pi, records, useSelfTrans, verbose, RNG );
 
-				// TODO capture the iteration after which no dynamic block structure is created, and use static emission data structure from there on
-
-				// get iteration types
-				bool samplePrior = true;
-				bool dynamic = true;
+			} else if ( fixedBlocks ) {
+				const string segmentFile = args.parse<string>( "-y", 1 );
 				if ( verbose ) {
-					cout << "Setting block structure to dynamic" << endl << flush;
+					cout << "Reading fixed blocks from " << segmentFile << endl << flush;
 				}
-				string method;
-				size_t iterations, thinning;
-				for ( size_t i = 0; i < nrTokens; ) {
-					string method = args.parse<string> ( "-i", i );	// G=direct gibbs, M=mixture, F = forward-backward gibbs
-					if ( samplePrior ) {
-						if ( verbose ) {
-							cout << "Sampling prior" << endl << flush;
-						}
-						theta.sample( tau_theta );
-						pi.sample( tau_pi );
-						A.sample( tau_A );
-						samplePrior = false;
-					}
-
-					if ( method == "P" ) {
-						samplePrior = true;
-						i ++;
-						continue;
-					}  else if ( method == "S" ) {
-						if ( verbose ) {
-							cout << "Setting block structure to static" << endl << flush;
-						}
-						y.createBlocks( theta );
-						dynamic = false;
-						i ++;
-						continue;
-					} else if ( method == "D" ) {
-						if ( verbose ) {
-							cout << "Setting block structure to dynamic" << endl << flush;
-						}
-						dynamic = true;
-						i ++;
-						continue;
-					} else {
-						if ( i + 2 >= nrTokens ) {
-							throw runtime_error( "Incomplete command line for -i!" );
-						}
-						iterations = args.parse<size_t> ( "-i", i + 1 );
-						thinning = args.parse<size_t> ( "-i", i + 2 );
-						i += 3;
-					}
-
-
-					if ( method == "F" ) {
-						if ( verbose ) {
-							// TODO more detailed output
-							cout << "Sampling Forward-Backward" << endl << flush;
-						}
-						StateSequence< ForwardBackward > q( RNG );
-						sampleHMM( y, q, theta, tau_theta, A, tau_A, pi, tau_pi,  mapping, iterations, thinning, records, dynamic, useSelfTrans );
-
-					} else if ( method == "M" ) {	// Mixture sampling
-						if ( verbose ) {
-							cout << "Sampling mixture" << endl << flush;
-						}
-						StateSequence< Mixture > q( RNG );
-						sampleHMM( y, q, theta, tau_theta, A, tau_A, pi, tau_pi,  mapping, iterations, thinning, records, dynamic, useSelfTrans );
-
-						/*} else if ( method == "G" ) {	// Direct Gibbs sampling
-							StateSequence< DirectGibbs > q( RNG );
-							sampleHMM( y, tau_theta, theta, tau_A, A, tau_pi, pi, q, mapping, iterations, thinning, records, i == 0, useSelfTrans );*/
+				vector<size_t> blockSizes = readSegmentSizes( segmentFile );
+				Blocks<Fixed> fixed( blockSizes );
+				if ( fixed.size() != T ) {
+					throw runtime_error( "Segments in " + segmentFile + " cover " + to_string( fixed.size() ) + " data points, but the input has " + to_string( T ) + "!" );
+				}
+				if ( verbose ) {
+					cout << "Number of fixed blocks: " << fixed.nrBlocks() << endl << flush;
+				}
+				runOnStatistics( prefixSums, stats, nrDataDim, nrThreads, fixed, args, thetaParams, stdEstimate, nrDataDim, mappingType, mapping, A, tau_A, pi, tau_pi, records, useSelfTrans, verbose, RNG );
 
-					} else {
-						throw runtime_error( "Unknown sampling type " + method + "!" );
-					}
+			} else if ( adaptiveBlocks ) {
+				// start from the blocks for a multiple of the noise threshold, refined by sampling type R in -i
+				const real_t coarsening = ( args.nrTokens( "-y" ) > 2 ? args.parse<real_t>( "-y", 2 ) : 2 );
+				Blocks<BreakpointArray> breakpoints( inputValues, nrThreads );
+				Blocks<Splittable> adaptive( breakpoints, coarsening * sqrt( 2 * log( ( real_t ) T ) ) * stdEstimate );
+				if ( verbose ) {
+					cout << "Number of initial adaptive blocks: " << adaptive.nrBlocks() << endl << flush;
 				}
-				samplePrior = false;
+				runOnStatistics( prefixSums, stats, nrDataDim, nrThreads, adaptive, args, thetaParams, stdEstimate, nrDataDim, mappingType, mapping, A, tau_A, pi, tau_pi, records, useSelfTrans, verbose, RNG );
 			}
 			// NOTE if marginals are to be saved, the output routine is automatically triggered by the destructor of records
 		} else {
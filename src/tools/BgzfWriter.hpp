@@ -0,0 +1,171 @@
+// Writes gzip-compressed text files in BGZF format, i.e. as a sequence of independent gzip members of at most 64 kB each, which are compressed on multiple threads. The output can be read by any gzip-compatible tool, as well as by bgzip and tabix.
+
+#ifndef BGZFWRITER_HPP
+#define BGZFWRITER_HPP
+
+#include "../Parallel.hpp"
+
+#include <zlib.h>
+
+#include <cstring>
+using std::memcpy;
+
+
+const size_t BGZF_MAX_INPUT_SIZE = 0xff00;	// uncompressed bytes per block, as used by bgzip, so that even incompressible blocks fit into 64 kB
+const size_t BGZF_WRITE_BLOCKS_PER_THREAD = 16;	// number of blocks compressed per thread and batch
+
+
+class BgzfWriter {
+
+		ofstream mFile;
+		const string mFilename;
+		const size_t mNrThreads;
+		const int mLevel;
+		string mBuffer;
+		vector<string> mBlocks;
+
+
+		static void putLittleEndian(
+		    char* data,
+		    size_t value,
+		    const size_t nrBytes ) {
+			for ( size_t i = 0; i < nrBytes; ++i ) {
+				data[i] = ( char )( value & 0xff );
+				value >>= 8;
+			}
+		}
+
+
+		// compress [data, data+size) into a complete BGZF block
+		void compressBlock(
+		    const char* data,
+		    const size_t size,
+		    string& block ) const {
+			const size_t headerSize = 18;
+			const size_t footerSize = 8;
+			block.resize( headerSize + compressBound( size ) + 16 + footerSize );
+
+			// if a block does not compress, store it instead
+			size_t compressedSize = 0;
+			for ( int level : {mLevel, 0} ) {
+				z_stream stream;
+				stream.zalloc = Z_NULL;
+				stream.zfree = Z_NULL;
+				stream.opaque = Z_NULL;
+				if ( deflateInit2( &stream, level, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY ) != Z_OK ) {
+					throw runtime_error( "Cannot initialize zlib!" );
+				}
+				stream.next_in = ( Bytef* ) data;
+				stream.avail_in = size;
+				stream.next_out = ( Bytef* )( &block[0] + headerSize );
+				stream.avail_out = block.size() - headerSize - footerSize;
+				const int status = deflate( &stream, Z_FINISH );
+				compressedSize = stream.total_out;
+				deflateEnd( &stream );
+				if ( status != Z_STREAM_END ) {
+					throw runtime_error( "Cannot compress output for " + mFilename + "!" );
+				}
+				if ( headerSize + compressedSize + footerSize <= 0x10000 ) {
+					break;
+				}
+			}
+			const size_t blockSize = headerSize + compressedSize + footerSize;
+			if ( blockSize > 0x10000 ) {
+				throw runtime_error( "BGZF block too large!" );
+			}
+
+			// gzip header with the BC extra field holding the total block size minus 1
+			const char header[] = {31, ( char ) 139, 8, 4, 0, 0, 0, 0, 0, ( char ) 255, 6, 0, 'B', 'C', 2, 0};
+			memcpy( &block[0], header, sizeof( header ) );
+			putLittleEndian( &block[16], blockSize - 1, 2 );
+			putLittleEndian( &block[headerSize + compressedSize], crc32( crc32( 0, Z_NULL, 0 ), ( const Bytef* ) data, size ), 4 );
+			putLittleEndian( &block[headerSize + compressedSize + 4], size, 4 );
+			block.resize( blockSize );
+		}
+
+
+		// compress and write all complete blocks in the buffer, or everything if <final> is set
+		void flush( const bool final ) {
+			const size_t nrBlocks = ( final ? ( mBuffer.size() + BGZF_MAX_INPUT_SIZE - 1 ) : mBuffer.size() ) / BGZF_MAX_INPUT_SIZE;
+			if ( nrBlocks == 0 ) {
+				return;
+			}
+			mBlocks.resize( max( mBlocks.size(), nrBlocks ) );
+			parallelFor( nrBlocks, mNrThreads, [&]( size_t b ) {
+				const size_t begin = b * BGZF_MAX_INPUT_SIZE;
+				compressBlock( mBuffer.data() + begin, min( BGZF_MAX_INPUT_SIZE, mBuffer.size() - begin ), mBlocks[b] );
+			} );
+			for ( size_t b = 0; b < nrBlocks; ++b ) {
+				mFile.write( mBlocks[b].data(), mBlocks[b].size() );
+			}
+			mBuffer.erase( 0, min( mBuffer.size(), nrBlocks * BGZF_MAX_INPUT_SIZE ) );
+			if ( !mFile ) {
+				throw runtime_error( "Cannot write to " + mFilename + "!" );
+			}
+		}
+
+	public:
+
+		// delete copy constructor
+		BgzfWriter( const BgzfWriter& that ) = delete;
+
+		BgzfWriter(
+		    const string& filename,
+		    const size_t nrThreads = 1,
+		    const int level = Z_DEFAULT_COMPRESSION ) :
+			mFile( filename, ios::binary ),
+			mFilename( filename ),
+			mNrThreads( max( nrThreads, ( size_t ) 1 ) ),
+			mLevel( level ) {
+			if ( !mFile ) {
+				throw runtime_error( "Cannot open " + filename + " for writing!" );
+			}
+			mBuffer.reserve( BGZF_MAX_INPUT_SIZE * BGZF_WRITE_BLOCKS_PER_THREAD * mNrThreads );
+		}
+
+		~BgzfWriter() {
+			if ( mFile.is_open() ) {
+				try {
+					close();
+				} catch ( ... ) {
+				}
+			}
+		}
+
+		void write(
+		    const char* data,
+		    const size_t size ) {
+			mBuffer.append( data, size );
+			if ( mBuffer.size() >= BGZF_MAX_INPUT_SIZE * BGZF_WRITE_BLOCKS_PER_THREAD * mNrThreads ) {
+				flush( false );
+			}
+		}
+
+		// write a non-negative integer followed by a newline
+		void writeLine( size_t value ) {
+			char digits[24];
+			char* end = digits + sizeof( digits );
+			char* begin = end;
+			*--begin = '\n';
+			do {
+				*--begin = '0' + value % 10;
+				value /= 10;
+			} while ( value > 0 );
+			write( begin, end - begin );
+		}
+
+		// write the remaining data, followed by the empty end-of-file block that marks a complete BGZF file
+		void close() {
+			flush( true );
+			string eof;
+			compressBlock( nullptr, 0, eof );
+			mFile.write( eof.data(), eof.size() );
+			mFile.close();
+			if ( !mFile ) {
+				throw runtime_error( "Cannot write to " + mFilename + "!" );
+			}
+		}
+};
+
+
+#endif
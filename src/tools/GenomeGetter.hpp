@@ -1,5 +1,8 @@
 // Class that reads compressed genome representations and serves as a kind of iterator.
 
+#ifndef GENOMEGETTER_HPP
+#define GENOMEGETTER_HPP
+
 #include <string>
 using std:: string;
 
@@ -120,3 +123,5 @@ class GenomeGetter {
 
 
 };
+
+#endif
@@ -0,0 +1,543 @@
+// Count read start positions in a SAM or BAM file, and write them as PREFIX-size.csv, PREFIX-pos.csv.gz and PREFIX-count.csv.gz. This is a drop-in replacement for bin/samToCounts, which pipes samtools view through cut, sort -V and uniq -c; here, all reads are collected in memory, and only the final counts are sorted.
+
+#include "../Reader.hpp"
+#include "../Parser.hpp"
+#include "BgzfWriter.hpp"
+
+#include <algorithm>
+using std::sort;
+using std::unique;
+
+#include <cctype>
+
+#include <cstring>
+using std::memchr;
+using std::memcmp;
+using std::strcmp;
+
+
+// A byte stream over a memory-mapped file, which is transparently decompressed if it is gzip-compressed (this includes BAM files, which are BGZF-compressed). Input that cannot be mapped, e.g. /dev/stdin or a named pipe, is streamed through zlib instead, which likewise decompresses gzip and passes everything else through.
+class ByteSource {
+
+		const MappedFile& mFile;
+		unique_ptr<GzipDecompressor> mGzip;
+		gzFile mStream;
+		vector<char> mChunk;
+		const char* mPos;
+		const char* mEnd;
+		string mScratch;
+
+
+		// move on to the next non-empty chunk; returns false at the end of the input
+		bool refill() {
+			if ( mStream != nullptr ) {
+				mChunk.resize( GZIP_CHUNK_SIZE );
+				const int n = gzread( mStream, mChunk.data(), mChunk.size() );
+				if ( n < 0 ) {
+					int status;
+					throw runtime_error( "Cannot read input (" + string( gzerror( mStream, &status ) ) + ")!" );
+				}
+				mPos = mChunk.data();
+				mEnd = mPos + n;
+				return n > 0;
+			}
+			while ( mGzip && mGzip->next( mChunk ) ) {
+				if ( mChunk.size() > 0 ) {
+					mPos = mChunk.data();
+					mEnd = mPos + mChunk.size();
+					return true;
+				}
+			}
+			return false;
+		}
+
+	public:
+
+		// delete copy constructor
+		ByteSource( const ByteSource& that ) = delete;
+
+		// <filename> is only opened if <file> could not be mapped
+		ByteSource(
+		    const MappedFile& file,
+		    const string& filename,
+		    const size_t nrThreads ) :
+			mFile( file ),
+			mStream( nullptr ),
+			mPos( file.begin() ),
+			mEnd( file.end() ) {
+			if ( !mFile.isOpen() ) {
+				mStream = gzopen( filename.c_str(), "rb" );
+				if ( mStream == nullptr ) {
+					throw runtime_error( "Cannot read from input file " + filename + "!" );
+				}
+				gzbuffer( mStream, GZIP_CHUNK_SIZE );
+				mPos = mEnd = nullptr;
+				refill();	// so that startsWith() can inspect the beginning
+			} else if ( isGzip( mFile ) ) {
+				mGzip.reset( new GzipDecompressor( mFile, nrThreads ) );
+				mPos = mEnd = nullptr;
+			}
+		}
+
+		~ByteSource() {
+			if ( mStream != nullptr ) {
+				gzclose( mStream );
+			}
+		}
+
+		// whether the (decompressed) input starts with <magic>
+		bool startsWith(
+		    const char* magic,
+		    const size_t size ) const {
+			if ( mGzip ) {
+				const vector<char>& first = mGzip->peek();
+				return first.size() >= size && memcmp( first.data(), magic, size ) == 0;
+			}
+			return ( size_t )( mEnd - mPos ) >= size && memcmp( mPos, magic, size ) == 0;
+		}
+
+		// Return a pointer to the next <size> contiguous bytes, which points into the input if possible, and to an internal copy if they span several chunks. Returns nullptr at the end of the input, and throws if it ends within the requested bytes.
+		const char* take( const size_t size ) {
+			if ( ( size_t )( mEnd - mPos ) >= size ) {
+				const char* data = mPos;
+				mPos += size;
+				return data;
+			}
+			mScratch.assign( mPos, mEnd );
+			mPos = mEnd;
+			while ( mScratch.size() < size && refill() ) {
+				const size_t n = min( size - mScratch.size(), ( size_t )( mEnd - mPos ) );
+				mScratch.append( mPos, n );
+				mPos += n;
+			}
+			if ( mScratch.size() == 0 && size > 0 ) {
+				return nullptr;
+			}
+			if ( mScratch.size() < size ) {
+				throw runtime_error( "Unexpected end of input!" );
+			}
+			return mScratch.data();
+		}
+
+		// Set [begin, end) to the next line, without the newline. Returns false at the end of the input.
+		bool nextLine(
+		    const char*& begin,
+		    const char*& end ) {
+			const char* newline = ( const char* ) memchr( mPos, '\n', mEnd - mPos );
+			if ( newline != nullptr ) {
+				begin = mPos;
+				end = newline;
+				mPos = newline + 1;
+				return true;
+			}
+			mScratch.assign( mPos, mEnd );
+			mPos = mEnd;
+			while ( refill() ) {
+				newline = ( const char* ) memchr( mPos, '\n', mEnd - mPos );
+				if ( newline != nullptr ) {
+					mScratch.append( mPos, newline );
+					mPos = newline + 1;
+					break;
+				}
+				mScratch.append( mPos, mEnd );
+				mPos = mEnd;
+			}
+			if ( newline == nullptr && mScratch.size() == 0 ) {
+				return false;
+			}
+			begin = mScratch.data();
+			end = begin + mScratch.size();
+			return true;
+		}
+};
+
+
+
+// A read mapped to a position, identified by a hash of its name. Reads with the same name, refseq and position are only counted once, since these are alternative alignments.
+struct ReadStart {
+	uint64_t pos;
+	uint64_t name;
+
+	bool operator<( const ReadStart& that ) const {
+		return pos < that.pos || ( pos == that.pos && name < that.name );
+	}
+
+	bool operator==( const ReadStart& that ) const {
+		return pos == that.pos && name == that.name;
+	}
+};
+
+
+struct MappedCount {
+	uint64_t pos;
+	uint64_t count;
+};
+
+
+// 64-bit FNV-1a followed by the splitmix64 finalizer. Collisions only matter between reads starting at the same position, so they are practically impossible.
+inline uint64_t hashName(
+    const char* begin,
+    const char* end ) {
+	uint64_t h = 0xcbf29ce484222325ULL;
+	for ( ; begin < end; ++begin ) {
+		h = ( h ^ ( unsigned char ) *begin ) * 0x100000001b3ULL;
+	}
+	h = ( h ^ ( h >> 30 ) ) * 0xbf58476d1ce4e5b9ULL;
+	h = ( h ^ ( h >> 27 ) ) * 0x94d049bb133111ebULL;
+	return h ^ ( h >> 31 );
+}
+
+
+// Collects read starts per refseq.
+class ReadStarts {
+
+		unordered_map<string, size_t> mIndex;
+		string mLastName;
+		size_t mLastIndex;
+
+	public:
+
+		vector<string> names;
+		vector<vector<ReadStart>> starts;
+
+		ReadStarts() :
+			mLastIndex( 0 ) {
+		}
+
+		// Index of a refseq, which is added if it has not been seen before. Since input is usually sorted by refseq, the last one is cached.
+		size_t refseq(
+		    const char* begin,
+		    const char* end ) {
+			if ( names.size() > 0 && ( size_t )( end - begin ) == mLastName.size() && memcmp( begin, mLastName.data(), mLastName.size() ) == 0 ) {
+				return mLastIndex;
+			}
+			mLastName.assign( begin, end );
+			const auto it = mIndex.find( mLastName );
+			if ( it != mIndex.end() ) {
+				mLastIndex = it->second;
+			} else {
+				mLastIndex = names.size();
+				mIndex[mLastName] = mLastIndex;
+				names.push_back( mLastName );
+				starts.push_back( vector<ReadStart>() );
+			}
+			return mLastIndex;
+		}
+
+		void add(
+		    const size_t refseq,
+		    const uint64_t pos,
+		    const uint64_t name ) {
+			starts[refseq].push_back( ReadStart{pos, name} );
+		}
+};
+
+
+
+// Read an unsigned decimal number from [begin, end).
+inline uint64_t parseUnsigned(
+    const char* begin,
+    const char* end,
+    const size_t lineNr ) {
+	if ( begin == end ) {
+		throw runtime_error( "Empty number in line " + to_string( lineNr ) + "!" );
+	}
+	uint64_t value = 0;
+	for ( ; begin < end; ++begin ) {
+		if ( *begin < '0' || *begin > '9' ) {
+			throw runtime_error( "Invalid number in line " + to_string( lineNr ) + "!" );
+		}
+		value = value * 10 + ( *begin - '0' );
+	}
+	return value;
+}
+
+
+// Read SAM records: QNAME, FLAG, RNAME and POS are the first 4 tab-separated fields. Header lines start with @.
+void readSam(
+    ByteSource& input,
+    const uint64_t filterBits,
+    ReadStarts& reads ) {
+	const char* begin;
+	const char* end;
+	size_t lineNr = 0;
+	while ( input.nextLine( begin, end ) ) {
+		lineNr++;
+		if ( begin == end || *begin == '@' ) {
+			continue;
+		}
+		const char* fields[5];
+		fields[0] = begin;
+		for ( size_t i = 1; i < 5; ++i ) {
+			const char* tab = ( const char* ) memchr( fields[i - 1], '\t', end - fields[i - 1] );
+			if ( tab == nullptr ) {
+				if ( i < 4 ) {
+					throw runtime_error( "Line " + to_string( lineNr ) + " has fewer than 4 fields!" );
+				}
+				tab = end;
+			}
+			fields[i] = tab + 1;
+		}
+		if ( ( parseUnsigned( fields[1], fields[2] - 1, lineNr ) & filterBits ) != 0 ) {
+			continue;
+		}
+		const size_t refseq = reads.refseq( fields[2], fields[3] - 1 );
+		reads.add( refseq, parseUnsigned( fields[3], fields[4] - 1, lineNr ), hashName( fields[0], fields[1] - 1 ) );
+	}
+}
+
+
+// Read BAM records, see the SAM/BAM specification. Positions are 0-based in BAM, but 1-based in SAM and the output. Unmapped reads have refID -1 and position -1, which samtools view shows as * and 0.
+void readBam(
+    ByteSource& input,
+    const uint64_t filterBits,
+    ReadStarts& reads ) {
+	input.take( 4 );	// magic
+	const size_t textSize = readLittleEndian( input.take( 4 ), 4 );
+	input.take( textSize );
+	const size_t nrRefs = readLittleEndian( input.take( 4 ), 4 );
+	vector<size_t> refIndex;
+	for ( size_t r = 0; r < nrRefs; ++r ) {
+		const size_t nameSize = readLittleEndian( input.take( 4 ), 4 );
+		const char* name = input.take( nameSize );
+		refIndex.push_back( reads.refseq( name, name + strlen( name ) ) );
+		input.take( 4 );	// reference length
+	}
+
+	const char* data;
+	while ( ( data = input.take( 4 ) ) != nullptr ) {
+		const size_t recordSize = readLittleEndian( data, 4 );
+		if ( recordSize < 32 ) {
+			throw runtime_error( "Corrupt BAM record!" );
+		}
+		data = input.take( recordSize );
+		const size_t flag = readLittleEndian( data + 14, 2 );
+		if ( ( flag & filterBits ) != 0 ) {
+			continue;
+		}
+		const int32_t refId = ( int32_t ) readLittleEndian( data, 4 );
+		const int32_t pos = ( int32_t ) readLittleEndian( data + 4, 4 );
+		const size_t nameSize = ( unsigned char ) data[8];
+		if ( 32 + nameSize > recordSize || nameSize == 0 ) {
+			throw runtime_error( "Corrupt BAM record!" );
+		}
+		size_t refseq;
+		if ( refId < 0 ) {
+			const char* unmapped = "*";
+			refseq = reads.refseq( unmapped, unmapped + 1 );
+		} else if ( ( size_t ) refId < nrRefs ) {
+			refseq = refIndex[refId];
+		} else {
+			throw runtime_error( "Invalid reference ID " + to_string( refId ) + " in BAM record!" );
+		}
+		reads.add( refseq, pos + 1, hashName( data + 32, data + 32 + nameSize - 1 ) );
+	}
+}
+
+
+
+// Version order as used by sort -V, i.e. GNU filevercmp: digit sequences are compared numerically, letters sort before other characters, ~ sorts before everything, and file name suffixes such as .txt are only considered to break ties.
+int versionOrder( const unsigned char c ) {
+	if ( c >= '0' && c <= '9' ) {
+		return 0;
+	} else if ( isalpha( c ) ) {
+		return c;
+	} else if ( c == '~' ) {
+		return -1;
+	} else {
+		return ( int ) c + 256;
+	}
+}
+
+
+int versionCompare(
+    const char* a,
+    const size_t aSize,
+    const char* b,
+    const size_t bSize ) {
+	size_t i = 0;
+	size_t j = 0;
+	while ( i < aSize || j < bSize ) {
+		int firstDiff = 0;
+		while ( ( i < aSize && !isdigit( a[i] ) ) || ( j < bSize && !isdigit( b[j] ) ) ) {
+			const int ac = ( i == aSize ? 0 : versionOrder( a[i] ) );
+			const int bc = ( j == bSize ? 0 : versionOrder( b[j] ) );
+			if ( ac != bc ) {
+				return ac - bc;
+			}
+			i++;
+			j++;
+		}
+		while ( i < aSize && a[i] == '0' ) {
+			i++;
+		}
+		while ( j < bSize && b[j] == '0' ) {
+			j++;
+		}
+		while ( i < aSize && j < bSize && isdigit( a[i] ) && isdigit( b[j] ) ) {
+			if ( firstDiff == 0 ) {
+				firstDiff = a[i] - b[j];
+			}
+			i++;
+			j++;
+		}
+		if ( i < aSize && isdigit( a[i] ) ) {
+			return 1;
+		}
+		if ( j < bSize && isdigit( b[j] ) ) {
+			return -1;
+		}
+		if ( firstDiff != 0 ) {
+			return firstDiff;
+		}
+	}
+	return 0;
+}
+
+
+// length of a string without its file name suffix, i.e. a trailing sequence of (\.[A-Za-z~][A-Za-z0-9~]*)
+size_t withoutSuffix( const string& s ) {
+	size_t match = s.size();
+	bool readAlpha = false;
+	for ( size_t i = 0; i < s.size(); ++i ) {
+		const char c = s[i];
+		if ( readAlpha ) {
+			readAlpha = false;
+			if ( !isalpha( c ) && c != '~' ) {
+				match = s.size();
+			}
+		} else if ( c == '.' ) {
+			readAlpha = true;
+			if ( match == s.size() ) {
+				match = i;
+			}
+		} else if ( !isalnum( c ) && c != '~' ) {
+			match = s.size();
+		}
+	}
+	return match;
+}
+
+
+bool versionLess(
+    const string& a,
+    const string& b ) {
+	if ( a == b ) {
+		return false;
+	}
+	if ( a.empty() || b.empty() ) {
+		return a.empty();
+	}
+	if ( a == "." || a == ".." || b == "." || b == ".." ) {
+		return a == "." || ( a == ".." && b != "." );
+	}
+	if ( ( a[0] == '.' ) != ( b[0] == '.' ) ) {
+		return a[0] == '.';
+	}
+	const size_t skip = ( a[0] == '.' ? 1 : 0 );
+	const size_t aSize = withoutSuffix( a.substr( skip ) );
+	const size_t bSize = withoutSuffix( b.substr( skip ) );
+	int result;
+	if ( aSize == bSize && a.compare( skip, aSize, b, skip, bSize ) == 0 ) {
+		result = versionCompare( a.data() + skip, a.size() - skip, b.data() + skip, b.size() - skip );
+	} else {
+		result = versionCompare( a.data() + skip, aSize, b.data() + skip, bSize );
+	}
+	return ( result == 0 ? strcmp( a.c_str(), b.c_str() ) < 0 : result < 0 );
+}
+
+
+
+int main( int argc, const char* argv[] ) {
+
+	try {
+		Parser args( argc, argv );
+
+		args.registerFlags( {"-i", "-input"} );
+		args.registerFlags( {"-o", "-out-prefix"} );
+		args.registerFlags( {"-F", "-filter-bits"}, "3844" );	// unmapped, not primary, QC fail, duplicate, supplementary
+		args.registerFlags( {"-j", "-threads"}, to_string( max( thread::hardware_concurrency(), 1u ) ) );
+		args.registerFlags( {"-h", "--help", "-help"}, "" );
+		args.parseArgs();
+
+		if ( args.isSet( "-h" ) ) {
+			cout << "Counts the leftmost mapping positions of reads in a SAM or BAM file (-i), which may be gzip-compressed, and may also be /dev/stdin or a named pipe. Reads with any of the filter bits (-F, default 3844) set in their flag are ignored, and a read that maps several times to the same position is only counted once. Writes the same files as samToCounts, using the output prefix -o: PREFIX-size.csv contains refseq names in version order (as in sort -V), their number of positions, and the cumulative sum thereof; PREFIX-pos.csv.gz and PREFIX-count.csv.gz contain the positions and their counts. Outputs are compressed as BGZF on multiple threads (-j, default: all cores), which also speeds up reading BAM files." << endl;
+			return 0;
+		}
+
+		const string inputFile = args.parse<string>( "-input" );
+		const string outPrefix = args.parse<string>( "-out-prefix" );
+		const uint64_t filterBits = args.parse<uint64_t>( "-filter-bits" );
+		const size_t nrThreads = args.parse<size_t>( "-threads" );
+		if ( nrThreads == 0 ) {
+			throw runtime_error( "Number of threads must be positive!" );
+		}
+
+		ReadStarts reads;
+		{
+			cout << "Reading " << inputFile << endl << flush;
+			MappedFile file( inputFile );
+			ByteSource input( file, inputFile, nrThreads );
+			if ( input.startsWith( "BAM\1", 4 ) ) {
+				readBam( input, filterBits, reads );
+			} else {
+				readSam( input, filterBits, reads );
+			}
+		}
+
+		// sort the reads of each refseq, remove duplicates, and count reads per position
+		vector<vector<MappedCount>> counts( reads.names.size() );
+		parallelFor( reads.names.size(), nrThreads, [&]( size_t r ) {
+			vector<ReadStart>& starts = reads.starts[r];
+			sort( starts.begin(), starts.end() );
+			starts.erase( unique( starts.begin(), starts.end() ), starts.end() );
+			for ( const auto & start : starts ) {
+				if ( counts[r].size() > 0 && counts[r].back().pos == start.pos ) {
+					counts[r].back().count++;
+				} else {
+					counts[r].push_back( MappedCount{start.pos, 1} );
+				}
+			}
+			vector<ReadStart>().swap( starts );
+		} );
+
+		vector<size_t> order;
+		for ( size_t r = 0; r < reads.names.size(); ++r ) {
+			if ( counts[r].size() > 0 ) {
+				order.push_back( r );
+			}
+		}
+		sort( order.begin(), order.end(), [&]( size_t a, size_t b ) {
+			return versionLess( reads.names[a], reads.names[b] );
+		} );
+
+		cout << "Writing output to " << outPrefix << "*" << endl << flush;
+		ofstream sizeFile( outPrefix + "-size.csv" );
+		if ( !sizeFile ) {
+			throw runtime_error( "Cannot open " + outPrefix + "-size.csv for writing!" );
+		}
+		BgzfWriter posFile( outPrefix + "-pos.csv.gz", nrThreads );
+		BgzfWriter countFile( outPrefix + "-count.csv.gz", nrThreads );
+		size_t totalSize = 0;
+		for ( auto r : order ) {
+			totalSize += counts[r].size();
+			sizeFile << reads.names[r] << "\t" << counts[r].size() << "\t" << totalSize << "\n";
+			for ( const auto & entry : counts[r] ) {
+				posFile.writeLine( entry.pos );
+				countFile.writeLine( entry.count );
+			}
+		}
+		sizeFile.close();
+		posFile.close();
+		countFile.close();
+		if ( !sizeFile ) {
+			throw runtime_error( "Cannot write to " + outPrefix + "-size.csv!" );
+		}
+
+		return 0;
+
+	} catch ( exception& e ) {
+		cerr << "[ERROR] " << e.what() << endl;
+		return 1;
+	}
+}
@@ -5,6 +5,9 @@
 
 #include "includes.hpp"
 
+#include <sys/mman.h>
+#include <unistd.h>
+
 
 
 enum Direction {forward, backward, unset};
@@ -93,6 +96,21 @@ void deleteVector( vector<T>& vec ) {
 }
 
 
+// Return the memory pages that lie entirely within [begin, end) to the operating system without freeing the allocation they belong to, e.g. for the part of a large vector that has already been copied elsewhere. The contents of the range are undefined afterwards, so it must not be read again before the vector is deleted.
+template <typename T>
+void releasePages(
+    const T* begin,
+    const T* end ) {
+	static_assert( std::is_trivially_copyable<T>::value, "Pages can only be released for trivial types!" );
+	static const uintptr_t pageSize = sysconf( _SC_PAGESIZE );
+	const uintptr_t first = ( ( uintptr_t ) begin + pageSize - 1 ) / pageSize * pageSize;
+	const uintptr_t last = ( uintptr_t ) end / pageSize * pageSize;
+	if ( first < last ) {
+		madvise( ( void* ) first, last - first, MADV_DONTNEED );
+	}
+}
+
+
 
 
 
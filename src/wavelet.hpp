@@ -3,12 +3,92 @@
 
 #include "includes.hpp"
 #include "uintmath.hpp"
+#include "Reader.hpp"
+#include "ChunkedArena.hpp"
+#include "Parallel.hpp"
 
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+
+
+const size_t HAAR_TILE_SIZE = 1 << 15;	// number of values processed together by the cache-blocked Haar routines, should fit into L2 cache
+const size_t MAXLET_CHUNK_SIZE = 1 << 16;	// number of positions per independently transformed subtree in the multithreaded maxlet transform
+const size_t MAXLET_CHUNKS_PER_THREAD = 4;	// number of chunks per thread and batch, so that threads can balance their load
+
+
+// Haar butterfly for one node: the left values become the sums, the right values the normalized differences, for all dimensions.
+inline void haarButterfly(
+    real_t* y,
+    real_t* z,
+    const size_t dim,
+    const real_t s ) {
+	size_t d = 0;
+#ifdef __SSE2__
+	const __m128 s4 = _mm_set1_ps( s );
+	for ( ; d + 4 <= dim; d += 4 ) {
+		const __m128 yL = _mm_loadu_ps( y + d );
+		const __m128 yR = _mm_loadu_ps( z + d );
+		_mm_storeu_ps( y + d, _mm_add_ps( yL, yR ) );
+		_mm_storeu_ps( z + d, _mm_mul_ps( s4, _mm_sub_ps( yL, yR ) ) );
+	}
+#endif
+	for ( ; d < dim; ++d ) {
+		const real_t yL = y[d];
+		const real_t yR = z[d];
+		y[d] = yL + yR;
+		z[d] = s * ( yL - yR );
+	}
+}
+
+
+// Apply the Haar levels with support sizes 2, 4, ..., maxN to the nodes starting in [begin, end) of y, which holds T positions of dim values each. Each position of y stands for <unit> input positions, which only affects the normalization.
+inline void haarDetailLevels(
+    real_t* y,
+    const size_t T,
+    const size_t dim,
+    const size_t begin,
+    const size_t end,
+    const size_t maxN,
+    const size_t unit ) {
+	for ( size_t N = 2; N <= maxN; N *= 2 ) {	// N is size of non-zero support interval
+		const real_t s = 1 / sqrt( N * unit );
+		size_t L = begin;
+#ifdef __SSE2__
+		// finest level of univariate data: process 4 adjacent nodes at once
+		if ( N == 2 && dim == 1 ) {
+			const __m128 s4 = _mm_set1_ps( s );
+			for ( ; L + 8 <= end && L + 8 <= T; L += 8 ) {
+				const __m128 v0 = _mm_loadu_ps( y + L );
+				const __m128 v1 = _mm_loadu_ps( y + L + 4 );
+				const __m128 yL = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 2, 0, 2, 0 ) );
+				const __m128 yR = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+				const __m128 sum = _mm_add_ps( yL, yR );
+				const __m128 diff = _mm_mul_ps( s4, _mm_sub_ps( yL, yR ) );
+				_mm_storeu_ps( y + L, _mm_unpacklo_ps( sum, diff ) );
+				_mm_storeu_ps( y + L + 4, _mm_unpackhi_ps( sum, diff ) );
+			}
+		}
+#endif
+		for ( ; L < end; L += N ) {
+			const size_t R = L + N / 2;
+			if ( R < T ) {
+				haarButterfly( y + L * dim, y + R * dim, dim, s );
+			} else {
+				for ( size_t d = 0; d < dim; ++d ) {
+					y[L * dim + d] = inf;
+				}
+			}
+		}
+	}
+}
 
 
 // TODO for implementation of chunks etc.: be carefull, we don't maintain scale coefficients!
 // In-place Haar transform, for arbitrary data sizes. Data is sorted by (position, dimension), and dimensions are processed in pseudo-parallel fashion. TODO acually make this parallel?
 // Data is treated like a greedy concatenation of vectors of sizes that are powers of two. In place where there would be the scale coefficient, the result is infinity.
+// The lower levels are computed tile by tile, so that each tile stays in cache; the upper levels only need the sums at the tile starts, which are processed as a small summary array. Every value undergoes the same operations in the same order as in a level-by-level pass over the whole array, so the result is identical.
 void HaarDetailCoeffs(
     vector<real_t>& y,
     size_t dim = 1 ) {
@@ -19,39 +99,29 @@ void HaarDetailCoeffs(
 		throw runtime_error( "Cannot compute Haar detail coefficients, array size is not a multiple of the number of dimensions!" );
 	}
 	const size_t T = Tdim / dim;	// number of input positions
-
-	real_t yL;
-	real_t yR;
-	size_t L;
-	size_t R;
-	size_t Ldim;
-	size_t Rdim;
 	const size_t Nup = ceilPow2( T );
-	for ( size_t N = 2; N <= Nup; N *= 2 ) {	// N is size of non-zero support interval
-		const real_t s = 1 / sqrt( N );
-		L = 0;
-		R = N / 2;
-		while ( L < T ) {
-			if ( R < T ) {
-				Ldim = L * dim;
-				Rdim = R * dim;
-				for ( size_t d = 0; d < dim; ++d ) {
-					yL = y[Ldim];
-					yR = y[Rdim];
-					y[Ldim] = yL + yR;
-					y[Rdim] = s * ( yL - yR );
-					Ldim ++;
-					Rdim++;
-				}
-			} else {
-				Ldim = L * dim;
-				for ( size_t d = 0; d < dim; ++d ) {
-					y[Ldim] = inf;
-					Ldim++;
-				}
+	const size_t tile = max( floorPow2( HAAR_TILE_SIZE / dim ), ( size_t ) 2 );	// positions per tile
+
+	if ( T <= tile ) {
+		haarDetailLevels( y.data(), T, dim, 0, T, Nup, 1 );
+	} else {
+		for ( size_t begin = 0; begin < T; begin += tile ) {
+			haarDetailLevels( y.data(), T, dim, begin, min( begin + tile, T ), tile, 1 );
+		}
+
+		// the upper levels only combine the sums at the start of each tile
+		const size_t nrTiles = ( T + tile - 1 ) / tile;
+		vector<real_t> summary( nrTiles * dim );
+		for ( size_t i = 0; i < nrTiles; ++i ) {
+			for ( size_t d = 0; d < dim; ++d ) {
+				summary[i * dim + d] = y[i * tile * dim + d];
+			}
+		}
+		haarDetailLevels( summary.data(), nrTiles, dim, 0, nrTiles, ceilPow2( nrTiles ), tile );
+		for ( size_t i = 0; i < nrTiles; ++i ) {
+			for ( size_t d = 0; d < dim; ++d ) {
+				y[i * tile * dim + d] = summary[i * dim + d];
 			}
-			L += N;
-			R += N;
 		}
 	}
 
@@ -63,8 +133,63 @@ void HaarDetailCoeffs(
 
 
 
+// Apply the breakpoint weight levels with half-supports topInterval, ..., 2, 1 to the targets in [begin, end) of an array of the given size. At each level, the targets are the boundaries of the wavelets, i.e. the multiples of 2*interval, and each target first takes the maximum with the midpoint of the wavelet to its left, then with the one to its right. Midpoints are only targets at lower levels, so they are read before they change.
+inline void breakpointWeightLevels(
+    real_t* weights,
+    const size_t size,
+    const size_t begin,
+    const size_t end,
+    const size_t topInterval ) {
+	for ( size_t interval = topInterval; interval >= 1; interval = interval / 2 ) {
+		const size_t shift = 2 * interval;
+		size_t t = begin;
+		if ( t == 0 && t < end ) {
+			// there is no wavelet to the left of the first target
+			const size_t index = interval;
+			if ( index < size ) {
+				if ( index + interval < size ) {
+					weights[0] = max( weights[0], weights[index] );
+				} else {
+					// NOTE just a precaution we expect this to be the case in the input
+					weights[0] = inf;
+					weights[index] = inf;
+				}
+			}
+			t += shift;
+		}
+#ifdef __SSE2__
+		// finest level: process 4 adjacent targets at once; _mm_max_ps( a, b ) returns b unless a > b, same as max( b, a )
+		if ( interval == 1 ) {
+			for ( ; t + 8 <= end && t + 8 < size; t += 8 ) {
+				const __m128 v0 = _mm_loadu_ps( weights + t );
+				const __m128 v1 = _mm_loadu_ps( weights + t + 4 );
+				const __m128 targets = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 2, 0, 2, 0 ) );
+				const __m128 right = _mm_shuffle_ps( v0, v1, _MM_SHUFFLE( 3, 1, 3, 1 ) );
+				const __m128 left = _mm_shuffle_ps( _mm_loadu_ps( weights + t - 1 ), _mm_loadu_ps( weights + t + 3 ), _MM_SHUFFLE( 2, 0, 2, 0 ) );
+				const __m128 result = _mm_max_ps( right, _mm_max_ps( left, targets ) );
+				_mm_storeu_ps( weights + t, _mm_unpacklo_ps( result, right ) );
+				_mm_storeu_ps( weights + t + 4, _mm_unpackhi_ps( result, right ) );
+			}
+		}
+#endif
+		for ( ; t < end; t += shift ) {
+			weights[t] = max( weights[t], weights[t - interval] );
+			const size_t index = t + interval;
+			if ( index < size ) {
+				if ( index + interval < size ) {
+					weights[t] = max( weights[t], weights[index] );
+				} else {
+					weights[t] = inf;
+					weights[index] = inf;
+				}
+			}
+		}
+	}
+}
+
 
 // Takes a maxlet transform, and computes the breakpoint weights, i.e. for each position t it computes the maximum absolute coefficient of all wavelets which have a discontinuity at t. Complexity is in-place in linear time.
+// The upper levels only involve multiples of the tile size, so they are computed on a small summary array first. The lower levels are then computed tile by tile from right to left, so that the midpoints each tile reads from the tile to its left have not yet been changed by lower levels. Every value undergoes the same operations in the same order as in a level-by-level pass over the whole array, so the result is identical.
 void HaarBreakpointWeights(
     vector< real_t >& weights	// absolute Haar wavelet coefficients
 ) {
@@ -72,119 +197,330 @@ void HaarBreakpointWeights(
 	if ( size <= 0 ) {
 		throw runtime_error( "Cannot compute Haar breakpoint weights, vector is empty!" );
 	}
-	size_t index;
-	size_t L;
-	size_t R;
-	for ( size_t interval = ceilPow2( size ) / 2; interval >= 1; interval = interval / 2 ) {	// size of the positive (or negative) support interval (half the support)
-		const size_t shift = 2 * interval;	// how far to advance to the next index
-		for ( size_t index = interval; index < size; index += shift ) {
-			L = index - interval;
-			R = index + interval;
-			if ( R < size ) {
-				weights[R] = max( weights[R], weights[index] );
-			} else {
-				// NOTE just a precaution we expect this to be the case in the input
-				weights[L] = inf;
-				weights[index] = inf;
-			}
-			weights[L] = max( weights[L], weights[index] );
-		}
+	const size_t tile = HAAR_TILE_SIZE;
+
+	if ( size <= tile ) {
+		breakpointWeightLevels( weights.data(), size, 0, size, ceilPow2( size ) / 2 );
+		return;
+	}
+
+	const size_t nrTiles = ( size + tile - 1 ) / tile;
+	vector<real_t> summary( nrTiles );
+	for ( size_t i = 0; i < nrTiles; ++i ) {
+		summary[i] = weights[i * tile];
+	}
+	breakpointWeightLevels( summary.data(), nrTiles, 0, nrTiles, ceilPow2( nrTiles ) / 2 );
+	for ( size_t i = 0; i < nrTiles; ++i ) {
+		weights[i * tile] = summary[i];
+	}
+
+	for ( size_t i = nrTiles; i > 0; --i ) {
+		const size_t begin = ( i - 1 ) * tile;
+		breakpointWeightLevels( weights.data(), size, begin, min( begin + tile, size ), tile / 2 );
 	}
 }
 
 
-// Computes the maxlet transform (absolute Haar wavelet transform  for each dimension, then maximum of corresponding values across dimensions) from streaming input (dimensions first, then position), using only space T for coefficients and nrDim*T for statistics, plus nrDim*log2(T) for a stack. Output: coeffs.size()=T, suffstats.size() = nrDim*T
+// Incrementally computes the maxlet transform (absolute Haar wavelet transform  for each dimension, then maximum of corresponding values across dimensions) from streaming input (dimensions first, then position), using only space T for coefficients and nrDim*T for statistics, plus nrDim*log2(T) for a stack. Each coefficient is stored at the midpoint index of its node, and positions that are not a midpoint (i.e. starts of power-of-two segments in a greedy decomposition) get infinity.
+// Values are collected in chunked arenas, so the input is read in a single pass without reallocating, and the output vectors are allocated exactly once.
 template< typename T>
-void MaxletTransform(
-    istream& input,
-    vector<real_t>& coeffs,
-    vector< SufficientStatistics<T> >& suffstats,
-    const size_t nrDim = 1,
-    const size_t reserveT = 0	// an estimate of the number of data points to avoid reallocation
-) {
+class MaxletBuilder {
 
-	if ( nrDim <= 0 ) {
-		throw runtime_error( "Number of dimensions must be positive!" );
-	}
+		const size_t mNrDim;
+		ChunkedArena<real_t> mCoeffs;
+		ChunkedArena<SufficientStatistics<T>> mStats;
 
+// 		stack<real_t, vector<real_t> > S;	// stack never gets larger than nrDim*log2(T), so we don't expect a lot of reallocation, and save a lot of push and pop operations due to random access
+		vector<real_t> mStack;	// sums of the values of completed subtrees, nrDim values each
+		size_t mIndex;	// number of positions added so far
 
-	if ( coeffs.size() > 0 ) {
-		throw runtime_error( "Coefficient array must be empty!" );
-	}
 
-	if ( suffstats.size() > 0 ) {
-		throw runtime_error( "Statistics array must be empty!" );
-	}
+		// Merge the completed subtree starting at position j, which is of size m, with its left siblings as far as possible, but only into nodes smaller than maxM. The sums of the subtrees are on <stack>. The coefficient of each merged node is stored at its midpoint.
+		inline void merge(
+		    vector<real_t>& stack,
+		    size_t j,
+		    size_t m,
+		    real_t normalizer,
+		    const size_t maxM = numeric_limits<size_t>::max() ) {
 
-	if ( input ) {
+			while ( ( j & m ) > 0 && m < maxM ) {	// while j is on a left-upward path (DFS post-order)
 
+				real_t maxCoeff = 0;	// the maximum detail coefficient across dimensions at j; NOTE we cannot take the maximum with coeffs because it contains infinity
 
-		coeffs.reserve( ( reserveT + nrDim ) / nrDim + nrDim );
-		suffstats.reserve( reserveT + nrDim );
+				size_t L = stack.size() - 2 * mNrDim;	// index of left element in stack, get incremented to iterate over dimensions
+				size_t R = L + mNrDim;	// likewise, index of right element in stack
 
-// 	stack<real_t, vector<real_t> > S;	// stack never gets larger than nrDim*log2(T), so we don't expect a lot of reallocation, and save a lot of push and pop operations due to random access
-		vector<real_t> S;
-		size_t i = 0;
-		real_t v = 0;
-		size_t dim = 0;
 
-		while ( input >> v ) {
-			S.push_back( v );
-			suffstats.push_back( SufficientStatistics<T>( v ) );
-			dim++;	// set dimension of next value
-			if ( dim == nrDim ) {	// filled all dimensions at index i
-				dim = 0;	// next value will be first dimension again
+				// compute maximum of detail coefficients across dimensions
+				for ( size_t d = 0; d < mNrDim; ++d ) {
+					maxCoeff = max( maxCoeff, normalizer * abs( stack[L] - stack[R] ) );
+					stack[L] += stack[R];	// add right values to left values, so only the right values need to be popped
+					L++;		// go to next dimension
+					R++;
+				}
+				mCoeffs[j] = maxCoeff;
 
 
-				coeffs.push_back( inf );
+				// pop the right values
+				for ( size_t d = 0; d < mNrDim; ++d ) {
+					stack.pop_back();
+				}
 
 
-				size_t j = i;	// points to node indices on an upward-left path (i.e. DFS post-order)
-				size_t m = 1;	// mask to determine whether j is an index of a left child
-				real_t normalizer = sqrt2half;
+				j = j - m;	// move to left parent (if current position is not a right child, the loop will exit)
+				m *= 2;	// move bit-mask to the left, i.e. check if i is still on a left-up path)
+				normalizer *= sqrt2half;	// moving up one level changes normalization factor
+			}
+		}
 
-				while ( ( j & m ) > 0 ) {	// while j is on a left-upward path (DFS post-order)
 
-					real_t maxCoeff = 0;	// the maximum detail coefficient across dimensions at j; NOTE we cannot take the maximum with coeffs because it contains infinity
+		// the normalizer for merging subtrees of size m, computed by the same sequence of multiplications as in merge()
+		static real_t normalizer( const size_t m ) {
+			real_t result = sqrt2half;
+			for ( size_t k = 1; k < m; k *= 2 ) {
+				result *= sqrt2half;
+			}
+			return result;
+		}
 
-					size_t L = S.size() - 2 * nrDim;	// index of left element in stack, get incremented to iterate over dimensions
-					size_t R = L + nrDim;	// likewise, index of right element in stack
+	public:
+
+		// delete copy constructor
+		MaxletBuilder( const MaxletBuilder& that ) = delete;
+
+		MaxletBuilder(
+		    const size_t nrDim = 1,
+		    const size_t reserveT = 0	// an estimate of the number of input values, i.e. nrDim times the number of positions, as returned by Reader::sizeHint(); if it is not exceeded, the output vectors are adopted without copying
+		) :
+			mNrDim( nrDim ),
+			mCoeffs( reserveT > 0 ? reserveT / max( nrDim, ( size_t ) 1 ) + 1 : 0 ),
+			mStats( reserveT > 0 ? reserveT + 2 * nrDim : 0 ),
+			mIndex( 0 ) {
+			if ( nrDim <= 0 ) {
+				throw runtime_error( "Number of dimensions must be positive!" );
+			}
+		}
 
 
-					// compute maximum of detail coefficients across dimensions
-					for ( size_t d = 0; d < nrDim; ++d ) {
-						maxCoeff = max( maxCoeff, normalizer * abs( S[L] - S[R] ) );
-						S[L] += S[R];	// add right values to left values, so only the right values need to be popped
-						L++;		// go to next dimension
-						R++;
-					}
-					coeffs[j] = maxCoeff;
+		// add the next position, given by its <nrDim> values
+		inline void add( const real_t* values ) {
+			for ( size_t d = 0; d < mNrDim; ++d ) {
+				mStack.push_back( values[d] );
+				mStats.push_back( SufficientStatistics<T>( values[d] ) );
+			}
+			mCoeffs.push_back( inf );
+			merge( mStack, mIndex, 1, sqrt2half );
+			mIndex++;
+		}
+
+
+		// Add <length> positions with identical values. All detail coefficients inside a constant run are zero, so each power-of-two aligned segment of the run is added as a single subtree, whose sum is known analytically, and only merged with its siblings once. The coefficients and statistics of the positions are still written one by one. The result is identical to adding the positions one by one.
+		void addRun(
+		    const real_t* values,
+		    size_t length ) {
+			while ( length > 0 ) {
 
+				// the largest subtree that starts at mIndex and fits into the run
+				size_t size = 1;
+				while ( 2 * size <= length && ( mIndex & size ) == 0 ) {
+					size *= 2;
+				}
 
-					// pop the right values
-					for ( size_t d = 0; d < nrDim; ++d ) {
-						S.pop_back();
+				for ( size_t p = 0; p < size; ++p ) {
+					for ( size_t d = 0; d < mNrDim; ++d ) {
+						mStats.push_back( SufficientStatistics<T>( values[d] ) );
 					}
+				}
+				for ( size_t d = 0; d < mNrDim; ++d ) {
+					mStack.push_back( values[d] * size );	// NOTE exact, same as adding pairwise
+				}
+
+				// the start of the subtree remains infinite unless it gets merged, all other coefficients are zero
+				mCoeffs.push_back( inf );
+				for ( size_t p = 1; p < size; ++p ) {
+					mCoeffs.push_back( 0 );
+				}
+				mIndex += size;
+				merge( mStack, mIndex - size, size, normalizer( size ) );
+				length -= size;
+			}
+		}
 
 
-					j = j - m;	// move to left parent (if current position is not a right child, the loop will exit)
-					m *= 2;	// move bit-mask to the left, i.e. check if i is still on a left-up path)
-					normalizer *= sqrt2half;	// moving up one level changes normalization factor
+		// Add <nrPositions> positions from <values> on multiple threads. The positions are split into chunks of MAXLET_CHUNK_SIZE, which are aligned subtrees because all batches except the last one must consist of whole chunks. Each chunk is transformed independently, and only the nodes above the chunks are merged afterwards, along the left spine. The result is identical to adding the positions one by one.
+		void addBatch(
+		    const real_t* values,
+		    const size_t nrPositions,
+		    const size_t nrThreads ) {
+			if ( mIndex % MAXLET_CHUNK_SIZE != 0 ) {
+				throw runtime_error( "Only the last batch of positions may contain an incomplete chunk!" );
+			}
+			const size_t begin = mIndex;
+			mCoeffs.grow( nrPositions );
+			mStats.grow( nrPositions * mNrDim );
+
+			const size_t nrChunks = ( nrPositions + MAXLET_CHUNK_SIZE - 1 ) / MAXLET_CHUNK_SIZE;
+			vector<vector<real_t>> stacks( nrChunks );
+			parallelFor( nrChunks, nrThreads, [&]( size_t c ) {
+				const size_t end = min( ( c + 1 ) * MAXLET_CHUNK_SIZE, nrPositions );
+				vector<real_t>& stack = stacks[c];
+				for ( size_t p = c * MAXLET_CHUNK_SIZE; p < end; ++p ) {
+					const size_t i = begin + p;
+					for ( size_t d = 0; d < mNrDim; ++d ) {
+						stack.push_back( values[p * mNrDim + d] );
+						mStats[i * mNrDim + d] = SufficientStatistics<T>( values[p * mNrDim + d] );
+					}
+					mCoeffs[i] = inf;
+					merge( stack, i, 1, sqrt2half, MAXLET_CHUNK_SIZE );
+				}
+			} );
+
+			// the stack of each chunk holds the sums of its greedy power-of-two subtrees, from largest to smallest, i.e. a single one for a complete chunk
+			for ( size_t c = 0; c < nrChunks; ++c ) {
+				size_t start = begin + c * MAXLET_CHUNK_SIZE;
+				const size_t length = min( MAXLET_CHUNK_SIZE, nrPositions - c * MAXLET_CHUNK_SIZE );
+				const real_t* sums = stacks[c].data();
+				for ( size_t size = MAXLET_CHUNK_SIZE; size > 0; size /= 2 ) {
+					if ( ( length & size ) > 0 ) {
+						mStack.insert( mStack.end(), sums, sums + mNrDim );
+						merge( mStack, start, size, normalizer( size ) );
+						sums += mNrDim;
+						start += size;
+					}
 				}
-				i++;
 			}
+			mIndex += nrPositions;
 		}
 
 
-		if ( dim != 0 ) {
-			throw runtime_error( "Input stream did not contain enough values to fill all dimensions at last position!" );
+		size_t size() const {
+			return mIndex;
 		}
 
-		coeffs[0] = inf;
 
-	} else {
-		throw runtime_error( "Cannot read input file or stream!" );
+		// Move the results to <coeffs> (size T) and <suffstats> (size nrDim*T, with capacity for nrDim additional elements, which are appended by Statistics<IntegralArray>).
+		void moveTo(
+		    vector<real_t>& coeffs,
+		    vector< SufficientStatistics<T> >& suffstats ) {
+			if ( mIndex == 0 ) {
+				throw runtime_error( "Input does not contain any data!" );
+			}
+			mCoeffs[0] = inf;
+			mCoeffs.moveTo( coeffs );
+			mStats.moveTo( suffstats, mNrDim );
+		}
+};
+
+
+
+// Computes the maxlet transform of values delivered by a reader, see MaxletBuilder. Output: coeffs.size()=T, suffstats.size() = nrDim*T
+template< typename T>
+void MaxletTransform(
+    Reader& input,
+    vector<real_t>& coeffs,
+    vector< SufficientStatistics<T> >& suffstats,
+    const size_t nrDim = 1,
+    const size_t reserveT = 0,	// an estimate of the number of input values; if it is not exceeded, the output vectors are adopted without copying
+    const size_t nrThreads = 1	// if larger than 1, the input is transformed in batches of chunks on multiple threads, see MaxletBuilder::addBatch()
+) {
+
+	if ( coeffs.size() > 0 ) {
+		throw runtime_error( "Coefficient array must be empty!" );
+	}
+
+	if ( suffstats.size() > 0 ) {
+		throw runtime_error( "Statistics array must be empty!" );
 	}
+
+	MaxletBuilder<T> builder( nrDim, reserveT );
+
+	if ( nrThreads > 1 ) {
+		// every batch except the last one must be filled completely, so that chunks stay aligned
+		vector<real_t> batch( nrThreads * MAXLET_CHUNKS_PER_THREAD * MAXLET_CHUNK_SIZE * nrDim );
+		size_t nrValues;
+		do {
+			size_t n;
+			nrValues = 0;
+			while ( nrValues < batch.size() && ( n = input.read( batch.data() + nrValues, batch.size() - nrValues ) ) > 0 ) {
+				nrValues += n;
+			}
+			if ( nrValues % nrDim != 0 ) {
+				throw runtime_error( "Input stream did not contain enough values to fill all dimensions at last position!" );
+			}
+			if ( nrValues > 0 ) {
+				builder.addBatch( batch.data(), nrValues / nrDim, nrThreads );
+			}
+		} while ( nrValues == batch.size() );
+		builder.moveTo( coeffs, suffstats );
+		return;
+	}
+
+	// values are parsed in blocks that fit into cache
+	vector<real_t> buffer( 1 << 14 );
+	size_t nrValues;
+	size_t dim = 0;	// number of values of the current position that are already in the buffer
+	while ( ( nrValues = input.read( buffer.data() + dim, buffer.size() - dim ) ) > 0 ) {
+		nrValues += dim;
+		size_t b = 0;
+		for ( ; b + nrDim <= nrValues; b += nrDim ) {
+			builder.add( buffer.data() + b );
+		}
+		// move an incomplete position to the front
+		dim = nrValues - b;
+		for ( size_t d = 0; d < dim; ++d ) {
+			buffer[d] = buffer[b + d];
+		}
+	}
+
+	if ( dim != 0 ) {
+		throw runtime_error( "Input stream did not contain enough values to fill all dimensions at last position!" );
+	}
+
+	builder.moveTo( coeffs, suffstats );
+}
+
+
+// Computes the maxlet transform of run-length encoded input. The wavelet tree of each run is merged per aligned subtree rather than per position, see MaxletBuilder::addRun(), but coefficients and statistics are still stored for every position, so time and memory remain linear in the number of positions.
+template< typename T>
+void MaxletTransform(
+    RunLengthReader& input,
+    vector<real_t>& coeffs,
+    vector< SufficientStatistics<T> >& suffstats,
+    const size_t nrDim = 1
+) {
+
+	if ( coeffs.size() > 0 ) {
+		throw runtime_error( "Coefficient array must be empty!" );
+	}
+
+	if ( suffstats.size() > 0 ) {
+		throw runtime_error( "Statistics array must be empty!" );
+	}
+
+	if ( input.nrDim() != nrDim ) {
+		throw runtime_error( "Run-length encoded input has " + to_string( input.nrDim() ) + " dimensions, but the model has " + to_string( nrDim ) + "!" );
+	}
+
+	MaxletBuilder<T> builder( nrDim );
+	vector<real_t> values( nrDim );
+	size_t length;
+	while ( input.nextRun( values.data(), length ) ) {
+		builder.addRun( values.data(), length );
+	}
+	builder.moveTo( coeffs, suffstats );
+}
+
+
+template< typename T>
+void MaxletTransform(
+    istream& input,
+    vector<real_t>& coeffs,
+    vector< SufficientStatistics<T> >& suffstats,
+    const size_t nrDim = 1,
+    const size_t reserveT = 0	// an estimate of the number of input values to avoid reallocation
+) {
+	StreamReader reader( input );
+	MaxletTransform( reader, coeffs, suffstats, nrDim, reserveT );
 }
 
 